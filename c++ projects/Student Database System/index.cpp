@@ -10,6 +10,44 @@
 #include <algorithm>
 #include <iomanip>
 #include <limits>
+#include <functional>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <array>
+#include <deque>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <cerrno>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+#include <string_view>
+#include <filesystem>
+#include <chrono>
+#include "../common/output_buffer.h"
+#include "../common/lz_block.h"
+#include "../common/tracing.h"
+#include "../common/mem_stats.h"
 
 struct Student {
     int rollNumber;
@@ -17,123 +55,2618 @@ struct Student {
     std::string department;
     float gpa;
     std::vector<float> grades;
+    double gradeSum = 0; // running sum of grades; add grades through addGrade()
     
     float calculateGPA() {
         if (grades.empty()) return 0.0f;
-        float sum = 0;
+        return static_cast<float>(gradeSum / grades.size());
+    }
+    
+    void updateGPA() {
+        gpa = calculateGPA();
+    }
+    
+    void addGrade(float grade) {
+        grades.push_back(grade);
+        gradeSum += grade;
+        updateGPA();
+    }
+};
+
+// Tag for --mem-stats: the store's record buffer
+struct StudentStoreMemory {
+    static constexpr const char* name = "StudentDatabase::students";
+};
+
+using StudentList = std::vector<Student, TrackingAllocator<Student, StudentStoreMemory>>;
+
+// Forward-only, page-at-a-time view over a student store. Only the current
+// page of pointers is held, so memory stays constant whatever the store size.
+// Pointers are valid until the store is next modified.
+class StudentCursor {
+public:
+    using Filter = std::function<bool(const Student&)>;
+    
+private:
+    const StudentList* store;
+    size_t pageSize;
+    Filter filter;
+    const std::vector<std::uint32_t>* byRoll; // store positions in roll order, for after()
+    std::vector<std::uint32_t> ownByRoll;     // built by after() when none was given
+    bool keyed = false; // after() was called: pos walks byRoll, not the store
+    size_t pos;         // next store index (or byRoll rank) to examine
+    int lastRoll;       // roll number of the last record handed out, -1 if none
+    
+    size_t end() const { return keyed ? byRoll->size() : store->size(); }
+    const Student& at(size_t i) const { return (*store)[keyed ? (*byRoll)[i] : i]; }
+    
+    bool matches(const Student& s) const {
+        return !filter || filter(s);
+    }
+    
+    // Moves pos onto the next matching record (or the end)
+    void seek() {
+        while (pos < end() && !matches(at(pos))) ++pos;
+    }
+    
+public:
+    // `rollOrder`, if given, lists the store's positions by ascending roll
+    // number and must stay valid as long as the cursor
+    StudentCursor(const StudentList& students, size_t pageSize, Filter filter = nullptr,
+                  const std::vector<std::uint32_t>* rollOrder = nullptr)
+        : store(&students), pageSize(pageSize ? pageSize : 1), filter(std::move(filter)),
+          byRoll(rollOrder), pos(0), lastRoll(-1) {
+        seek();
+    }
+    
+    // Offset continuation: skips the first `count` matching records
+    StudentCursor& skip(size_t count) {
+        for (; count > 0 && pos < end(); --count) {
+            ++pos;
+            seek();
+        }
+        return *this;
+    }
+    
+    // Keyset continuation: from here on records come in roll-number order,
+    // starting at the first roll number above `rollNumber`. Inserts and
+    // deletes between pages, including of that record, neither end nor skip
+    // the scan. after(std::numeric_limits<int>::min()) starts from the top.
+    StudentCursor& after(int rollNumber) {
+        if (!byRoll) {
+            ownByRoll.resize(store->size());
+            for (size_t i = 0; i < ownByRoll.size(); ++i) ownByRoll[i] = static_cast<std::uint32_t>(i);
+            std::sort(ownByRoll.begin(), ownByRoll.end(), [this](std::uint32_t a, std::uint32_t b) {
+                return (*store)[a].rollNumber < (*store)[b].rollNumber;
+            });
+            byRoll = &ownByRoll;
+        }
+        keyed = true;
+        pos = static_cast<size_t>(std::upper_bound(byRoll->begin(), byRoll->end(), rollNumber,
+            [this](int roll, std::uint32_t p) { return roll < (*store)[p].rollNumber; }) - byRoll->begin());
+        seek();
+        return *this;
+    }
+    
+    // Fills `page` with up to pageSize matching records; false once exhausted
+    bool nextPage(std::vector<const Student*>& page) {
+        page.clear();
+        while (page.size() < pageSize && pos < end()) {
+            page.push_back(&at(pos));
+            ++pos;
+            seek();
+        }
+        if (!page.empty()) lastRoll = page.back()->rollNumber;
+        return !page.empty();
+    }
+    
+    bool done() const { return pos >= end(); }
+    
+    // Token for after(): the roll number of the last record returned
+    int continuationKey() const { return lastRoll; }
+};
+
+// ============================================================
+// STUDENT QUERY LANGUAGE
+//   [where] <expr> [order by <field> [asc|desc]] [limit <n>]
+//   expr:   term {or term}      term: factor {and factor}
+//   factor: ( expr ) | field op value | field between value and value
+//   fields: roll name dept gpa grades (number of grades)
+//   ops:    = != < <= > >= ~ (substring)
+// e.g. dept = CS and gpa > 3.5 and grades >= 5 order by gpa desc limit 10
+// ============================================================
+
+class StudentQuery {
+public:
+    enum class Field { ROLL, NAME, DEPT, GPA, GRADES };
+    enum class Op { EQ, NE, LT, LE, GT, GE, CONTAINS, BETWEEN };
+    
+private:
+    // Keeps the positions in `sel` that satisfy pred, preserving their order
+    template <typename Pred>
+    static void keepIf(std::vector<std::uint32_t>& sel, Pred pred) {
+        size_t kept = 0;
+        for (size_t i = 0; i < sel.size(); ++i) {
+            sel[kept] = sel[i];
+            kept += pred(sel[i]) ? 1 : 0;
+        }
+        sel.resize(kept);
+    }
+    
+    // One tight loop per (field type, operator); the switch runs once per batch
+    template <typename T, typename Get>
+    static void compare(std::vector<std::uint32_t>& sel, Get get, Op op, T lo, T hi) {
+        switch (op) {
+            case Op::EQ: keepIf(sel, [&](std::uint32_t i) { return get(i) == lo; }); break;
+            case Op::NE: keepIf(sel, [&](std::uint32_t i) { return get(i) != lo; }); break;
+            case Op::LT: keepIf(sel, [&](std::uint32_t i) { return get(i) < lo; }); break;
+            case Op::LE: keepIf(sel, [&](std::uint32_t i) { return get(i) <= lo; }); break;
+            case Op::GT: keepIf(sel, [&](std::uint32_t i) { return get(i) > lo; }); break;
+            case Op::GE: keepIf(sel, [&](std::uint32_t i) { return get(i) >= lo; }); break;
+            case Op::BETWEEN:
+                keepIf(sel, [&](std::uint32_t i) { T v = get(i); return v >= lo && v <= hi; });
+                break;
+            case Op::CONTAINS: break; // strings only, handled by the caller
+        }
+    }
+    
+public:
+    // Parsed filter. narrow() evaluates it a batch of store positions at a time.
+    struct Expr {
+        enum Kind { CMP, AND, OR } kind = AND; // an AND without terms matches everything
+        Field field = Field::ROLL;
+        Op op = Op::EQ;
+        double lo = 0;       // numeric operand
+        double hi = 0;       // upper bound for BETWEEN
+        std::string text;    // string operand (lo/hi hold nothing then)
+        std::string textHi;
+        std::vector<Expr> kids;
+        
+        // Removes from `sel` the positions whose records do not match
+        void narrow(const StudentList& store, std::vector<std::uint32_t>& sel) const {
+            if (kind == AND) {
+                for (const Expr& k : kids) {
+                    if (sel.empty()) return;
+                    k.narrow(store, sel);
+                }
+                return;
+            }
+            if (kind == OR) {
+                std::vector<std::uint8_t> hit(sel.size(), 0);
+                std::vector<std::uint32_t> part;
+                for (const Expr& k : kids) {
+                    part = sel;
+                    k.narrow(store, part);
+                    // part is a subsequence of sel: walk both to mark the survivors
+                    for (size_t i = 0, j = 0; i < sel.size() && j < part.size(); ++i) {
+                        if (sel[i] == part[j]) {
+                            hit[i] = 1;
+                            ++j;
+                        }
+                    }
+                }
+                size_t kept = 0;
+                for (size_t i = 0; i < sel.size(); ++i) {
+                    sel[kept] = sel[i];
+                    kept += hit[i];
+                }
+                sel.resize(kept);
+                return;
+            }
+            
+            const Student* s = store.data();
+            switch (field) {
+                case Field::ROLL:
+                    compare<double>(sel, [s](std::uint32_t i) { return static_cast<double>(s[i].rollNumber); },
+                                    op, lo, hi);
+                    break;
+                case Field::GRADES:
+                    compare<double>(sel, [s](std::uint32_t i) { return static_cast<double>(s[i].grades.size()); },
+                                    op, lo, hi);
+                    break;
+                case Field::GPA:
+                    compare<float>(sel, [s](std::uint32_t i) { return s[i].gpa; },
+                                   op, static_cast<float>(lo), static_cast<float>(hi));
+                    break;
+                case Field::NAME:
+                case Field::DEPT: {
+                    bool byName = field == Field::NAME;
+                    auto get = [s, byName](std::uint32_t i) {
+                        return std::string_view(byName ? s[i].name : s[i].department);
+                    };
+                    if (op == Op::CONTAINS) {
+                        keepIf(sel, [&](std::uint32_t i) { return get(i).find(text) != std::string_view::npos; });
+                    } else {
+                        compare<std::string_view>(sel, get, op, text, textHi);
+                    }
+                    break;
+                }
+            }
+        }
+    };
+    
+    Expr where;
+    bool ordered = false;
+    Field orderBy = Field::ROLL;
+    bool descending = false;
+    size_t limit = 0; // 0 = no limit
+    
+private:
+    struct Token {
+        enum Kind { WORD, STRING, SYMBOL, END } kind;
+        std::string text;
+    };
+    
+    struct Parser {
+        std::vector<Token> tokens;
+        size_t pos = 0;
+        std::string error;
+        
+        const Token& peek() const { return tokens[pos]; }
+        
+        bool fail(const std::string& message) {
+            if (error.empty()) error = message;
+            return false;
+        }
+        
+        bool isKeyword(const char* word) const {
+            const Token& t = peek();
+            if (t.kind != Token::WORD || t.text.size() != std::strlen(word)) return false;
+            for (size_t i = 0; i < t.text.size(); ++i) {
+                if (std::tolower(static_cast<unsigned char>(t.text[i])) != word[i]) return false;
+            }
+            return true;
+        }
+        
+        bool keyword(const char* word) {
+            if (!isKeyword(word)) return false;
+            ++pos;
+            return true;
+        }
+        
+        bool symbol(const char* sym) {
+            if (peek().kind != Token::SYMBOL || peek().text != sym) return false;
+            ++pos;
+            return true;
+        }
+        
+        bool parseField(Field& field) {
+            static const std::pair<const char*, Field> NAMES[] = {
+                {"roll", Field::ROLL}, {"name", Field::NAME}, {"dept", Field::DEPT},
+                {"department", Field::DEPT}, {"gpa", Field::GPA}, {"grades", Field::GRADES}};
+            for (const auto& n : NAMES) {
+                if (keyword(n.first)) {
+                    field = n.second;
+                    return true;
+                }
+            }
+            return fail("expected a field (roll, name, dept, gpa, grades) near '" + peek().text + "'");
+        }
+        
+        bool parseValue(Field field, double& number, std::string& text) {
+            const Token& t = peek();
+            if (t.kind != Token::WORD && t.kind != Token::STRING) return fail("expected a value");
+            if (field == Field::NAME || field == Field::DEPT) {
+                text = t.text;
+            } else {
+                char* end = nullptr;
+                number = std::strtod(t.text.c_str(), &end);
+                if (t.kind != Token::WORD || t.text.empty() || *end != '\0') {
+                    return fail("expected a number, got '" + t.text + "'");
+                }
+            }
+            ++pos;
+            return true;
+        }
+        
+        bool parseFactor(Expr& out) {
+            if (symbol("(")) {
+                if (!parseExpr(out)) return false;
+                return symbol(")") || fail("missing ')'");
+            }
+            out.kind = Expr::CMP;
+            if (!parseField(out.field)) return false;
+            bool numeric = out.field != Field::NAME && out.field != Field::DEPT;
+            if (keyword("between")) {
+                out.op = Op::BETWEEN;
+                if (!parseValue(out.field, out.lo, out.text)) return false;
+                if (!keyword("and")) return fail("expected 'and' in between");
+                return parseValue(out.field, out.hi, out.textHi);
+            }
+            static const std::pair<const char*, Op> OPS[] = {
+                {"=", Op::EQ}, {"!=", Op::NE}, {"<", Op::LT}, {"<=", Op::LE},
+                {">", Op::GT}, {">=", Op::GE}, {"~", Op::CONTAINS}};
+            for (const auto& o : OPS) {
+                if (symbol(o.first)) {
+                    if (o.second == Op::CONTAINS && numeric) return fail("'~' only applies to name and dept");
+                    out.op = o.second;
+                    return parseValue(out.field, out.lo, out.text);
+                }
+            }
+            return fail("expected an operator near '" + peek().text + "'");
+        }
+        
+        // term {and term} / factor {or factor}: a single child is returned unwrapped
+        bool parseList(Expr& out, Expr::Kind kind) {
+            const char* joiner = kind == Expr::OR ? "or" : "and";
+            Expr first;
+            if (!(kind == Expr::OR ? parseList(first, Expr::AND) : parseFactor(first))) return false;
+            if (!isKeyword(joiner)) {
+                out = std::move(first);
+                return true;
+            }
+            out.kind = kind;
+            out.kids.push_back(std::move(first));
+            while (keyword(joiner)) {
+                Expr next;
+                if (!(kind == Expr::OR ? parseList(next, Expr::AND) : parseFactor(next))) return false;
+                out.kids.push_back(std::move(next));
+            }
+            return true;
+        }
+        
+        bool parseExpr(Expr& out) {
+            return parseList(out, Expr::OR);
+        }
+    };
+    
+    static bool tokenize(const std::string& text, std::vector<Token>& tokens, std::string& error) {
+        size_t i = 0;
+        while (i < text.size()) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (std::isspace(c)) {
+                ++i;
+            } else if (c == '"' || c == '\'') {
+                size_t close = text.find(static_cast<char>(c), i + 1);
+                if (close == std::string::npos) {
+                    error = "unterminated string";
+                    return false;
+                }
+                tokens.push_back({Token::STRING, text.substr(i + 1, close - i - 1)});
+                i = close + 1;
+            } else if (std::strchr("=!<>~()", c)) {
+                size_t len = (i + 1 < text.size() && text[i + 1] == '=' && std::strchr("!<>", c)) ? 2 : 1;
+                if (c == '!' && len == 1) {
+                    error = "'!' must be followed by '='";
+                    return false;
+                }
+                tokens.push_back({Token::SYMBOL, text.substr(i, len)});
+                i += len;
+            } else {
+                size_t start = i;
+                while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])) &&
+                       !std::strchr("=!<>~()\"'", text[i])) {
+                    ++i;
+                }
+                tokens.push_back({Token::WORD, text.substr(start, i - start)});
+            }
+        }
+        tokens.push_back({Token::END, ""});
+        return true;
+    }
+    
+public:
+    // Fills `query` from `text`; on failure returns false with a reason in `error`
+    static bool parse(const std::string& text, StudentQuery& query, std::string& error) {
+        Parser p;
+        if (!tokenize(text, p.tokens, error)) return false;
+        
+        query = StudentQuery();
+        p.keyword("where");
+        if (p.peek().kind != Token::END && !p.isKeyword("order") && !p.isKeyword("limit")) {
+            if (!p.parseExpr(query.where)) {
+                error = p.error;
+                return false;
+            }
+        }
+        if (p.keyword("order")) {
+            if (!p.keyword("by")) p.fail("expected 'by' after 'order'");
+            else if (p.parseField(query.orderBy)) {
+                query.ordered = true;
+                if (p.keyword("desc")) query.descending = true;
+                else p.keyword("asc");
+            }
+        }
+        if (p.error.empty() && p.keyword("limit")) {
+            const Token& t = p.peek();
+            char* end = nullptr;
+            long n = std::strtol(t.text.c_str(), &end, 10);
+            if (t.kind != Token::WORD || t.text.empty() || *end != '\0' || n <= 0) p.fail("limit must be a positive number");
+            else {
+                query.limit = static_cast<size_t>(n);
+                ++p.pos;
+            }
+        }
+        if (p.error.empty() && p.peek().kind != Token::END) p.fail("unexpected '" + p.peek().text + "'");
+        error = p.error;
+        return error.empty();
+    }
+    
+    bool filtered() const {
+        return where.kind != Expr::AND || !where.kids.empty();
+    }
+};
+
+// Streams query results. Candidate positions come from `source` a batch at a
+// time (an index lookup or a slice of the store) and are narrowed by the
+// filter before being handed out. Like StudentCursor, pointers are valid
+// until the store is next modified.
+class QueryCursor {
+public:
+    // Clears and refills the batch; returns false once no candidates remain
+    using Source = std::function<bool(std::vector<std::uint32_t>&)>;
+    
+private:
+    const StudentList* store;
+    Source source;
+    StudentQuery::Expr filter;
+    bool filtered;
+    size_t remaining;   // limit still available
+    std::vector<std::uint32_t> batch;
+    size_t batchPos = 0;
+    bool exhausted = false;
+    size_t examined = 0;
+    
+    // Pulls batches until one has a match or the source runs dry
+    void fill() {
+        while (batchPos >= batch.size() && !exhausted) {
+            TRACE_SCOPE("queryBatch");
+            exhausted = !source(batch);
+            TRACE_RECORDS(batch.size());
+            examined += batch.size();
+            if (filtered) filter.narrow(*store, batch);
+            batchPos = 0;
+        }
+    }
+    
+public:
+    // `examined` counts records a caller already filtered to build the source
+    QueryCursor(const StudentList& students, Source source, StudentQuery::Expr filter,
+                bool filtered, size_t limit, size_t examined = 0)
+        : store(&students), source(std::move(source)), filter(std::move(filter)), filtered(filtered),
+          remaining(limit ? limit : std::numeric_limits<size_t>::max()), examined(examined) {}
+          
+    // Next matching record, or nullptr at the end
+    const Student* next() {
+        if (remaining == 0) return nullptr;
+        fill();
+        if (batchPos >= batch.size()) return nullptr;
+        --remaining;
+        return &(*store)[batch[batchPos++]];
+    }
+    
+    // Fills `page` with up to pageSize results; false once exhausted
+    bool nextPage(std::vector<const Student*>& page, size_t pageSize) {
+        page.clear();
+        while (page.size() < pageSize) {
+            const Student* s = next();
+            if (!s) break;
+            page.push_back(s);
+        }
+        return !page.empty();
+    }
+    
+    bool done() {
+        if (remaining == 0) return true;
+        fill();
+        return batchPos >= batch.size();
+    }
+    
+    // Candidate records the filter has looked at so far
+    size_t recordsExamined() const { return examined; }
+};
+
+// ============================================================
+// CRC32C (Castagnoli) block checksums
+// Uses the SSE4.2 / ARMv8 CRC instructions when the CPU has them
+// ============================================================
+
+inline std::uint32_t crc32cSoftware(std::uint32_t crc, const unsigned char* p, size_t n) {
+    static const auto table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    for (size_t i = 0; i < n; ++i) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+__attribute__((target("sse4.2")))
+inline std::uint32_t crc32cHardware(std::uint32_t crc, const unsigned char* p, size_t n) {
+    std::uint64_t c = crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        c = __builtin_ia32_crc32di(c, word);
+    }
+    std::uint32_t c32 = static_cast<std::uint32_t>(c);
+    for (; n > 0; --n, ++p) c32 = __builtin_ia32_crc32qi(c32, *p);
+    return c32;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+inline std::uint32_t crc32cHardware(std::uint32_t crc, const unsigned char* p, size_t n) {
+    for (; n >= 8; n -= 8, p += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        crc = __crc32cd(crc, word);
+    }
+    for (; n > 0; --n, ++p) crc = __crc32cb(crc, *p);
+    return crc;
+}
+#endif
+
+inline std::uint32_t crc32c(const void* data, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+#if defined(__GNUC__) && defined(__x86_64__)
+    static const bool hasHardware = __builtin_cpu_supports("sse4.2");
+    if (hasHardware) return ~crc32cHardware(~0u, p, n);
+#elif defined(__ARM_FEATURE_CRC32)
+    return ~crc32cHardware(~0u, p, n);
+#endif
+    return ~crc32cSoftware(~0u, p, n);
+}
+
+// ============================================================
+// THREAD POOL
+// Fixed workers shared by partition loads, encoding and writes
+// ============================================================
+
+class TaskPool {
+private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+    
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return !tasks.empty() || stopping; });
+            if (tasks.empty()) break;
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+    
+public:
+    explicit TaskPool(unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+        for (unsigned t = 0; t < threads; ++t) workers.emplace_back(&TaskPool::loop, this);
+    }
+    
+    // Runs every queued task before returning
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+    
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+    
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+    
+    // Runs fn(i) for every i in [0, n) and returns once all are done. The
+    // caller takes indices too, so a pool busy with other tasks only makes
+    // this slower, never stuck.
+    template <typename Fn>
+    void forEach(size_t n, Fn fn) {
+        struct Shared {
+            std::atomic<size_t> next{0};
+            std::mutex mutex;
+            std::condition_variable done;
+            size_t helpers = 0;
+        };
+        auto shared = std::make_shared<Shared>();
+        auto work = [shared, &fn, n] {
+            for (size_t i; (i = shared->next++) < n;) fn(i);
+        };
+        shared->helpers = n > 1 ? std::min<size_t>(size(), n - 1) : 0;
+        for (size_t h = 0, count = shared->helpers; h < count; ++h) {
+            submit([shared, work] {
+                work();
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                if (--shared->helpers == 0) shared->done.notify_all();
+            });
+        }
+        work();
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->done.wait(lock, [&shared] { return shared->helpers == 0; });
+    }
+};
+
+// ============================================================
+// BACKGROUND SNAPSHOT WRITER
+// Replaces a set of data files atomically: each file goes through
+// temp file, fsync, rename, and a final commit file switches over
+// ============================================================
+
+class SnapshotWriter {
+public:
+    // Files written together. The last one is the commit point: it is only
+    // written once every other file is durable, and files of the previous
+    // image that it no longer names are removed after it.
+    struct Image {
+        std::vector<std::pair<std::string, std::string>> files; // path, contents
+    };
+    
+private:
+    TaskPool& pool;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    Image pending;             // newest image not yet written
+    bool hasPending = false;
+    bool writing = false;
+    bool stopping = false;
+    std::atomic<bool> failed{false};
+    std::vector<std::string> current; // files of the image on disk
+    std::thread worker;
+    
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return hasPending || stopping; });
+            if (!hasPending) break;
+            Image image = std::move(pending);
+            hasPending = false;
+            writing = true;
+            std::vector<std::string> previous = current;
+            lock.unlock();
+            bool ok = writeImage(image, previous);
+            lock.lock();
+            if (ok) {
+                current.clear();
+                for (const auto& f : image.files) current.push_back(f.first);
+            } else {
+                failed = true;
+            }
+            writing = false;
+            idle.notify_all();
+        }
+    }
+    
+    // Data files in parallel, then the commit file, then cleanup
+    bool writeImage(const Image& image, const std::vector<std::string>& previous) {
+        if (image.files.empty()) return true;
+        const size_t last = image.files.size() - 1;
+        std::atomic<bool> ok{true};
+        pool.forEach(last, [&](size_t i) {
+            if (!writeAtomically(image.files[i].first, image.files[i].second)) ok = false;
+        });
+        auto named = [&image](const std::string& path) {
+            for (const auto& f : image.files) {
+                if (f.first == path) return true;
+            }
+            return false;
+        };
+        if (!ok || !writeAtomically(image.files[last].first, image.files[last].second)) {
+            for (size_t i = 0; i < last; ++i) {
+                if (std::find(previous.begin(), previous.end(), image.files[i].first) == previous.end()) {
+                    std::remove(image.files[i].first.c_str());
+                }
+            }
+            return false;
+        }
+        for (const auto& old : previous) {
+            if (!named(old)) std::remove(old.c_str());
+        }
+        return true;
+    }
+    
+public:
+    explicit SnapshotWriter(TaskPool& pool) : pool(pool) {
+        worker = std::thread(&SnapshotWriter::loop, this);
+    }
+    
+    // Writes out whatever is still queued before returning
+    ~SnapshotWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+    
+    // Records the files the image already on disk consists of, so the
+    // first save can remove the ones it replaces
+    void adopt(std::vector<std::string> files) {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = std::move(files);
+    }
+    
+    // Queues an image and returns at once. Saves that pile up behind a slow
+    // disk coalesce: only the newest image is written.
+    void submit(Image image) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = std::move(image);
+            hasPending = true;
+        }
+        wake.notify_one();
+    }
+    
+    // Blocks until every submitted image is on disk
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return !hasPending && !writing; });
+    }
+    
+    // True once per failed write since the last call
+    bool takeFailure() {
+        return failed.exchange(false);
+    }
+    
+    // Either the old file or the complete new one survives a crash, never a mix
+    static bool writeAtomically(const std::string& path, const std::string& data) {
+        TRACE_SCOPE("writeAtomically");
+        TRACE_BYTES_WRITTEN(data.size());
+        const std::string tmp = path + ".tmp";
+#if defined(_WIN32)
+        int fd = _open(tmp.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if (fd < 0) return false;
+        bool ok = _write(fd, data.data(), static_cast<unsigned>(data.size())) == static_cast<int>(data.size());
+        ok = _commit(fd) == 0 && ok;
+        ok = _close(fd) == 0 && ok;
+        return ok && MoveFileExA(tmp.c_str(), path.c_str(),
+                                 MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = true;
+        for (size_t done = 0; ok && done < data.size();) {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            ok = n > 0;
+            if (ok) done += static_cast<size_t>(n);
+        }
+        ok = ::fsync(fd) == 0 && ok;
+        ok = ::close(fd) == 0 && ok;
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        // Make the rename itself durable
+        size_t slash = path.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+        int dirFd = ::open(dir.c_str(), O_RDONLY);
+        if (dirFd >= 0) {
+            ::fsync(dirFd);
+            ::close(dirFd);
+        }
+        return true;
+#endif
+    }
+};
+
+// ============================================================
+// PARALLEL SORTING
+// Orders (key, index) pairs instead of whole Student objects:
+// LSD radix sort for numeric keys, merge sort for names
+// ============================================================
+
+class StudentSorter {
+private:
+    static constexpr size_t MIN_PER_THREAD = 1 << 16;
+    static constexpr int RADIX_BITS = 8;
+    static constexpr size_t BUCKETS = size_t(1) << RADIX_BITS;
+    
+    static unsigned threadsFor(size_t n) {
+        size_t hw = std::max(1u, std::thread::hardware_concurrency());
+        return static_cast<unsigned>(std::max<size_t>(1, std::min(hw, n / MIN_PER_THREAD)));
+    }
+    
+    // Runs body(t, begin, end) over `threads` contiguous slices of [0, n)
+    template <typename Fn>
+    static void parallelSlices(size_t n, unsigned threads, Fn body) {
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) {
+            pool.emplace_back(body, t, n * t / threads, n * (t + 1) / threads);
+        }
+        body(0u, size_t(0), n / threads);
+        for (auto& th : pool) th.join();
+    }
+    
+    static constexpr size_t PREFIX_BYTES = 7; // name bytes per key; the eighth is a length
+    
+    // PREFIX_BYTES name bytes from `skip` on, big-endian, so integer order is
+    // byte order, then the length left after `skip`, capped at
+    // PREFIX_BYTES + 1 ("runs past the window"). The length sorts a name that
+    // ends inside the window before one that continues with '\0'.
+    static std::uint64_t namePrefix(const std::string& name, size_t skip) {
+        std::uint64_t prefix = 0;
+        for (size_t i = skip; i < skip + PREFIX_BYTES; ++i) {
+            prefix = (prefix << 8) | (i < name.size() ? static_cast<unsigned char>(name[i]) : 0);
+        }
+        size_t left = name.size() > skip ? name.size() - skip : 0;
+        return (prefix << 8) | std::min(left, PREFIX_BYTES + 1);
+    }
+    
+public:
+    // Unsigned keys that sort like the original values
+    static std::uint32_t intKey(int v) {
+        return static_cast<std::uint32_t>(v) ^ 0x80000000u;
+    }
+    
+    static std::uint32_t floatKey(float f) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+    
+    // Indices of `keys` in ascending key order; equal keys keep their order
+    static std::vector<std::uint32_t> radixOrder(std::vector<std::uint32_t> keys) {
+        size_t n = keys.size();
+        std::vector<std::uint32_t> index(n);
+        for (size_t i = 0; i < n; ++i) index[i] = static_cast<std::uint32_t>(i);
+        if (n < 2) return index;
+        
+        std::vector<std::uint32_t> keysOut(n);
+        std::vector<std::uint32_t> indexOut(n);
+        unsigned threads = threadsFor(n);
+        std::vector<std::array<size_t, BUCKETS>> offsets(threads);
+        for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+            parallelSlices(n, threads, [&](unsigned t, size_t begin, size_t end) {
+                auto& count = offsets[t];
+                count.fill(0);
+                for (size_t i = begin; i < end; ++i) count[(keys[i] >> shift) & (BUCKETS - 1)]++;
+            });
+            
+            // A digit every key shares (the high bytes of roll numbers) needs no pass
+            size_t shared = (keys[0] >> shift) & (BUCKETS - 1);
+            size_t sharedCount = 0;
+            for (const auto& count : offsets) sharedCount += count[shared];
+            if (sharedCount == n) continue;
+            
+            // Slice t writes its digit-d keys after every smaller digit and
+            // after the digit-d keys of slices before it
+            size_t sum = 0;
+            for (size_t d = 0; d < BUCKETS; ++d) {
+                for (auto& count : offsets) {
+                    size_t c = count[d];
+                    count[d] = sum;
+                    sum += c;
+                }
+            }
+            parallelSlices(n, threads, [&](unsigned t, size_t begin, size_t end) {
+                auto& pos = offsets[t];
+                for (size_t i = begin; i < end; ++i) {
+                    size_t p = pos[(keys[i] >> shift) & (BUCKETS - 1)]++;
+                    keysOut[p] = keys[i];
+                    indexOut[p] = index[i];
+                }
+            });
+            keys.swap(keysOut);
+            index.swap(indexOut);
+        }
+        return index;
+    }
+    
+    // Indices of `students` by name. Each thread sorts a slice comparing
+    // 8-byte prefixes first, then slices are merged pairwise in parallel.
+    static std::vector<std::uint32_t> nameOrder(const StudentList& students) {
+        struct Entry {
+            std::uint64_t prefix;
+            std::uint32_t index;
+        };
+        size_t n = students.size();
+        // Bytes every name shares ("Student 1", "Student 2", ...) decide nothing
+        size_t skip = n ? students[0].name.size() : 0;
+        for (size_t i = 1; i < n && skip > 0; ++i) {
+            const std::string& name = students[i].name;
+            size_t k = 0;
+            while (k < skip && k < name.size() && name[k] == students[0].name[k]) ++k;
+            skip = k;
+        }
+        
+        std::vector<Entry> entries(n);
+        for (size_t i = 0; i < n; ++i) {
+            entries[i] = {namePrefix(students[i].name, skip), static_cast<std::uint32_t>(i)};
+        }
+        
+        auto before = [&students, skip](const Entry& a, const Entry& b) {
+            if (a.prefix != b.prefix) return a.prefix < b.prefix;
+            int c = std::string_view(students[a.index].name).substr(skip).compare(
+                std::string_view(students[b.index].name).substr(skip));
+            return c != 0 ? c < 0 : a.index < b.index;
+        };
+        
+        unsigned threads = threadsFor(n);
+        std::vector<size_t> runs; // run r is [runs[r], runs[r + 1])
+        for (unsigned t = 0; t <= threads; ++t) runs.push_back(n * t / threads);
+        parallelSlices(n, threads, [&](unsigned, size_t begin, size_t end) {
+            std::sort(entries.begin() + begin, entries.begin() + end, before);
+        });
+        
+        std::vector<Entry> merged(n);
+        while (runs.size() > 2) {
+            std::vector<size_t> next;
+            std::vector<std::thread> pool;
+            for (size_t r = 0; r + 1 < runs.size(); r += 2) {
+                size_t lo = runs[r], mid = runs[r + 1];
+                size_t hi = r + 2 < runs.size() ? runs[r + 2] : mid;
+                pool.emplace_back([&, lo, mid, hi] {
+                    std::merge(entries.begin() + lo, entries.begin() + mid, entries.begin() + mid,
+                               entries.begin() + hi, merged.begin() + lo, before);
+                });
+                next.push_back(lo);
+            }
+            next.push_back(n);
+            for (auto& th : pool) th.join();
+            entries.swap(merged);
+            runs.swap(next);
+        }
+        
+        std::vector<std::uint32_t> order(n);
+        for (size_t i = 0; i < n; ++i) order[i] = entries[i].index;
+        return order;
+    }
+    
+    // Rearranges `students` so that position i holds the old students[order[i]].
+    // Each record moves once; threads fill disjoint slices of the result.
+    // Returns false if the order was already the identity.
+    static bool permute(StudentList& students, const std::vector<std::uint32_t>& order) {
+        bool unchanged = true;
+        for (size_t i = 0; i < order.size() && unchanged; ++i) unchanged = order[i] == i;
+        if (unchanged) return false; // e.g. sorting by roll number a store that only ever appended
+        
+        StudentList sorted(students.size());
+        parallelSlices(order.size(), threadsFor(order.size()), [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) sorted[i] = std::move(students[order[i]]);
+        });
+        students.swap(sorted);
+        return true;
+    }
+};
+
+// ============================================================
+// GRADE DISTRIBUTION
+// A quantile sketch and fixed-band histograms; both merge, so
+// loaders and report shards build them independently
+// ============================================================
+
+// KLL sketch (Karnin, Lang, Liberty). Level h holds items that stand for
+// 2^h grades each. A full level is sorted and a random half of it (every
+// other item) moves up, so memory stays around 3K items however many
+// grades go in, and a quantile is off by at most about 1% of rank.
+class QuantileSketch {
+private:
+    static constexpr size_t K = 256;        // capacity of the top level
+    static constexpr size_t MIN_CAPACITY = 8;
+    
+    std::vector<std::vector<float>> levels = std::vector<std::vector<float>>(1);
+    std::uint64_t count = 0;
+    float lowest = std::numeric_limits<float>::infinity();
+    float highest = -std::numeric_limits<float>::infinity();
+    size_t firstCapacity = K;
+    std::uint64_t coin = 0x9E3779B97F4A7C15ull; // xorshift state: which half of a level survives
+    
+    // Levels shrink by 2/3 going down from the top
+    size_t capacity(size_t level) const {
+        double c = K;
+        for (size_t depth = levels.size() - 1 - level; depth > 0 && c > MIN_CAPACITY; --depth) c *= 2.0 / 3.0;
+        return std::max<size_t>(MIN_CAPACITY, static_cast<size_t>(c));
+    }
+    
+    size_t flip() {
+        coin ^= coin << 13;
+        coin ^= coin >> 7;
+        coin ^= coin << 17;
+        return static_cast<size_t>(coin & 1);
+    }
+    
+    void compact() {
+        for (size_t h = 0; h < levels.size(); ++h) {
+            if (levels[h].size() < capacity(h)) continue;
+            if (h + 1 == levels.size()) levels.emplace_back();
+            std::vector<float>& items = levels[h];
+            std::vector<float>& up = levels[h + 1];
+            std::sort(items.begin(), items.end());
+            size_t offset = flip();
+            for (size_t i = 0; i + 1 < items.size(); i += 2) up.push_back(items[i + offset]);
+            if (items.size() % 2) {
+                items[0] = items.back();
+                items.resize(1);
+            } else {
+                items.clear();
+            }
+        }
+        firstCapacity = capacity(0);
+    }
+    
+public:
+    void add(float v) {
+        if (v != v) return; // NaN has no rank
+        levels[0].push_back(v);
+        count++;
+        lowest = std::min(lowest, v);
+        highest = std::max(highest, v);
+        if (levels[0].size() >= firstCapacity) compact();
+    }
+    
+    void merge(const QuantileSketch& o) {
+        if (o.count == 0) return;
+        if (levels.size() < o.levels.size()) levels.resize(o.levels.size());
+        for (size_t h = 0; h < o.levels.size(); ++h) {
+            levels[h].insert(levels[h].end(), o.levels[h].begin(), o.levels[h].end());
+        }
+        count += o.count;
+        lowest = std::min(lowest, o.lowest);
+        highest = std::max(highest, o.highest);
+        compact();
+    }
+    
+    std::uint64_t size() const { return count; }
+    
+    // Value at quantile q (0..1); 0 when empty
+    float quantile(double q) const {
+        if (count == 0) return 0;
+        if (q <= 0) return lowest;
+        if (q >= 1) return highest;
+        std::vector<std::pair<float, std::uint64_t>> weighted;
+        for (size_t h = 0; h < levels.size(); ++h) {
+            for (float v : levels[h]) weighted.push_back({v, std::uint64_t(1) << h});
+        }
+        std::sort(weighted.begin(), weighted.end());
+        double target = q * count;
+        std::uint64_t seen = 0;
+        for (const auto& w : weighted) {
+            seen += w.second;
+            if (seen >= target) return w.first;
+        }
+        return highest;
+    }
+};
+
+// Grades counted in 10-point bands, 0-9.99 up to 90-100, with one more
+// band each for grades below 0 and above 100. Counts are exact, so
+// removing a student's grades undoes adding them.
+class GradeHistogram {
+public:
+    static constexpr int BANDS = 10;
+    static constexpr float BAND_WIDTH = 10.0f;
+    static constexpr int BELOW = 0;             // band index of grades under 0 (and NaN)
+    static constexpr int ABOVE = BANDS + 1;     // band index of grades over 100
+    
+private:
+    std::array<std::uint64_t, BANDS + 2> counts{};
+    std::uint64_t total = 0;
+    
+    static int bandOf(float g) {
+        if (!(g >= 0)) return BELOW;
+        if (g > BANDS * BAND_WIDTH) return ABOVE;
+        return 1 + std::min(BANDS - 1, static_cast<int>(g / BAND_WIDTH));
+    }
+    
+public:
+    void add(float g) {
+        counts[bandOf(g)]++;
+        total++;
+    }
+    
+    void remove(float g) {
+        counts[bandOf(g)]--;
+        total--;
+    }
+    
+    void merge(const GradeHistogram& o) {
+        for (size_t b = 0; b < counts.size(); ++b) counts[b] += o.counts[b];
+        total += o.total;
+    }
+    
+    std::uint64_t band(int b) const { return counts[b]; }
+    std::uint64_t size() const { return total; }
+};
+
+class StudentDatabase {
+private:
+    // One data file of the store with the zone map the manifest keeps for it:
+    // bounds on what its records can hold, so a query can tell it has nothing
+    // to find there without reading it
+    struct Partition {
+        std::string path;
+        std::uint64_t records = 0;
+        int minRoll = std::numeric_limits<int>::min();
+        int maxRoll = std::numeric_limits<int>::max();
+        float minGpa = -std::numeric_limits<float>::infinity();
+        float maxGpa = std::numeric_limits<float>::infinity();
+        bool deptsKnown = false;        // else any department may occur
+        std::vector<std::string> depts; // sorted
+        bool legacy = false;            // a version 1 students.dat
+    };
+    
+    struct LoadedChunk {
+        size_t partition;
+        std::vector<Student> records;
+        bool last; // the partition has no more records after these
+        QuantileSketch grades; // of these records, built by the loader
+    };
+    
+    // Where a loaded chunk landed in the store, to restore the saved order
+    struct Span {
+        size_t start;
+        size_t count;
+        size_t partition;
+    };
+    
+    TaskPool pool;
+    StudentList students;
+    const std::string filename = "students.dat";           // single-file layout, read only
+    const std::string manifestName = "students.manifest";  // partitioned layout
+    int nextRollNumber;
+    SnapshotWriter writer{pool};
+    bool dirty = false;            // store differs from the last save
+    bool rollNumbersKnown = true;  // nextRollNumber is final before loading finishes
+    std::uint32_t generation = 0;  // of the partition files last loaded or saved
+    
+    // Partitions are loaded by pool tasks in loadQueue order and absorbed in
+    // partition order; demand for a record moves its partition to the front
+    // of both (see absorbLoaded)
+    std::vector<Partition> partitions;  // fixed while loading
+    std::vector<char> partitionAbsorbed;
+    std::vector<char> demanded;
+    std::vector<std::deque<LoadedChunk>> parked; // per partition, in arrival order
+    size_t nextInOrder = 0;             // first partition not fully absorbed
+    bool outOfOrder = false;            // a demanded partition jumped ahead
+    std::vector<Span> absorbedSpans;
+    std::mutex loadMutex;
+    std::condition_variable loadProgress;
+    std::deque<size_t> loadQueue;                   // partitions no task has started
+    std::vector<LoadedChunk> loadedChunks;          // decoded by the loaders, not yet in the store
+    std::string loadNotes;                          // loader warnings, printed by absorbLoaded
+    size_t loadsRunning = 0;
+    bool loadFinished = true;
+    std::atomic<bool> loadCancelled{false};
+    size_t pendingRecords = 0;                      // manifest/header count not yet absorbed
+    static constexpr size_t VIEW_PAGE_SIZE = 10;
+    static constexpr size_t REPORT_TOP_K = 3;
+    static constexpr int REPORT_PERCENTILES[] = {10, 25, 50, 75, 90, 99};
+    
+    // ---- running aggregates, updated in O(log n) on add/update/delete ----
+    
+    // Orders students best first: higher GPA, then lower roll number
+    struct GpaRank {
+        float gpa;
+        int roll;
+        bool operator<(const GpaRank& o) const {
+            if (gpa != o.gpa) return gpa > o.gpa;
+            return roll < o.roll;
+        }
+    };
+    
+    struct DeptStats {
+        size_t count = 0;
+        double gpaTotal = 0;
+        std::set<int> rolls; // index for dept = "..." queries
+        GradeHistogram grades;
+    };
+    
+    std::set<GpaRank> ranking;
+    std::map<std::string, DeptStats> departments;
+    double gpaTotal = 0;
+    std::unordered_map<int, size_t> rollIndex; // roll number -> position in students
+    std::vector<std::uint32_t> rollOrder;      // positions by roll number, for keyset cursors
+    bool rollOrderStale = true;                // rebuilt by cursor() after any add, delete or sort
+    QuantileSketch gradeSketch;                // every grade in the store
+    bool gradeSketchStale = false;             // a delete took grades out; rebuilt before the next read
+    
+    void track(const Student& s) {
+        ranking.insert({s.gpa, s.rollNumber});
+        DeptStats& d = departments[s.department];
+        d.count++;
+        d.gpaTotal += s.gpa;
+        d.rolls.insert(s.rollNumber);
+        for (float g : s.grades) d.grades.add(g);
+        gpaTotal += s.gpa;
+    }
+    
+    void untrack(const Student& s) {
+        ranking.erase({s.gpa, s.rollNumber});
+        auto it = departments.find(s.department);
+        if (it != departments.end()) {
+            it->second.gpaTotal -= s.gpa;
+            it->second.rolls.erase(s.rollNumber);
+            for (float g : s.grades) it->second.grades.remove(g);
+            if (--it->second.count == 0) departments.erase(it);
+        }
+        gpaTotal -= s.gpa;
+    }
+    
+    // Positions shift after deletes and sorts
+    void rebuildRollIndex() {
+        rollOrderStale = true;
+        rollIndex.clear();
+        rollIndex.reserve(students.size());
+        for (size_t i = 0; i < students.size(); ++i) rollIndex[students[i].rollNumber] = i;
+    }
+    
+    // A sketch cannot forget grades, so after a delete it is rebuilt: one
+    // shard of the store per pool task, merged at the end
+    void refreshGradeSketch() {
+        if (!gradeSketchStale) return;
+        size_t shards = std::min<size_t>(pool.size() + 1, students.size() / 4096 + 1);
+        std::vector<QuantileSketch> parts(shards);
+        pool.forEach(shards, [&](size_t i) {
+            size_t end = students.size() * (i + 1) / shards;
+            for (size_t r = students.size() * i / shards; r < end; ++r) {
+                for (float g : students[r].grades) parts[i].add(g);
+            }
+        });
+        gradeSketch = QuantileSketch();
+        for (const auto& part : parts) gradeSketch.merge(part);
+        gradeSketchStale = false;
+    }
+    
+    // ---- query planning ----
+    static constexpr size_t QUERY_BATCH = 1024;
+    static constexpr size_t INDEX_MAX_FRACTION = 4; // index paths over n/4 rows lose to a scan
+    
+    // How candidate positions are produced for a query
+    struct AccessPath {
+        enum Kind { SCAN, ROLL_PROBE, DEPT, GPA_RANGE, UNION } kind = SCAN;
+        double estimate = 0;            // expected candidate rows
+        double lo = -std::numeric_limits<double>::infinity();
+        double hi = std::numeric_limits<double>::infinity();
+        std::string dept;
+        std::vector<AccessPath> parts;  // UNION branches
+    };
+    
+    // Rows in the GPA range, assuming GPAs are spread evenly between the extremes
+    double estimateGpaRange(double lo, double hi) const {
+        if (ranking.empty()) return 0;
+        double top = ranking.begin()->gpa;
+        double bottom = ranking.rbegin()->gpa;
+        lo = std::max(lo, bottom);
+        hi = std::min(hi, top);
+        if (hi < lo) return 0;
+        if (top == bottom) return static_cast<double>(ranking.size());
+        return ranking.size() * (hi - lo) / (top - bottom) + 1;
+    }
+    
+    // Cheapest index path for `e`, or SCAN. Bounds are widened to inclusive;
+    // the full filter still runs on every candidate.
+    AccessPath planAccess(const StudentQuery::Expr& e) const {
+        using Expr = StudentQuery::Expr;
+        using Field = StudentQuery::Field;
+        using Op = StudentQuery::Op;
+        AccessPath scan;
+        scan.estimate = static_cast<double>(students.size());
+        
+        if (e.kind == Expr::OR) {
+            AccessPath all;
+            all.kind = AccessPath::UNION;
+            for (const Expr& k : e.kids) {
+                all.parts.push_back(planAccess(k));
+                if (all.parts.back().kind == AccessPath::SCAN) return scan;
+                all.estimate += all.parts.back().estimate;
+            }
+            return all.estimate * INDEX_MAX_FRACTION > students.size() ? scan : all;
+        }
+        
+        std::vector<const Expr*> terms;
+        if (e.kind == Expr::AND) {
+            for (const Expr& k : e.kids) terms.push_back(&k);
+        } else {
+            terms.push_back(&e);
+        }
+        
+        AccessPath roll, gpa, best = scan;
+        roll.kind = AccessPath::ROLL_PROBE;
+        gpa.kind = AccessPath::GPA_RANGE;
+        auto consider = [&best](const AccessPath& p) {
+            if (p.estimate < best.estimate) best = p;
+        };
+        for (const Expr* t : terms) {
+            if (t->kind != Expr::CMP) {
+                consider(planAccess(*t));
+                continue;
+            }
+            if (t->field == Field::DEPT && t->op == Op::EQ) {
+                AccessPath dept;
+                dept.kind = AccessPath::DEPT;
+                dept.dept = t->text;
+                auto it = departments.find(t->text);
+                dept.estimate = it == departments.end() ? 0 : static_cast<double>(it->second.count);
+                consider(dept);
+                continue;
+            }
+            if (t->field != Field::ROLL && t->field != Field::GPA) continue;
+            AccessPath& p = t->field == Field::ROLL ? roll : gpa;
+            switch (t->op) {
+                case Op::EQ: p.lo = std::max(p.lo, t->lo); p.hi = std::min(p.hi, t->lo); break;
+                case Op::GT: case Op::GE: p.lo = std::max(p.lo, t->lo); break;
+                case Op::LT: case Op::LE: p.hi = std::min(p.hi, t->lo); break;
+                case Op::BETWEEN: p.lo = std::max(p.lo, t->lo); p.hi = std::min(p.hi, t->hi); break;
+                default: break;
+            }
+        }
+        if (std::isfinite(roll.lo) && std::isfinite(roll.hi)) {
+            // Rolls are ints: clamp so the probe's casts stay in range
+            roll.lo = std::max(std::ceil(roll.lo), static_cast<double>(std::numeric_limits<int>::min()));
+            roll.hi = std::min(std::floor(roll.hi), static_cast<double>(std::numeric_limits<int>::max()));
+            roll.estimate = roll.hi < roll.lo ? 0 : roll.hi - roll.lo + 1;
+            consider(roll);
+        }
+        if (std::isfinite(gpa.lo) || std::isfinite(gpa.hi)) {
+            gpa.estimate = estimateGpaRange(gpa.lo, gpa.hi);
+            consider(gpa);
+        }
+        return best.estimate * INDEX_MAX_FRACTION > students.size() ? scan : best;
+    }
+    
+    std::string describe(const AccessPath& p) const {
+        auto bound = [](double v) {
+            if (!std::isfinite(v)) return std::string(v < 0 ? "min" : "max");
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%g", v);
+            return std::string(buf);
+        };
+        std::string rows = " (~" + std::to_string(static_cast<size_t>(p.estimate)) + " rows)";
+        switch (p.kind) {
+            case AccessPath::SCAN: return "full scan" + rows;
+            case AccessPath::ROLL_PROBE: return "roll index " + bound(p.lo) + ".." + bound(p.hi) + rows;
+            case AccessPath::DEPT: return "dept index = \"" + p.dept + "\"" + rows;
+            case AccessPath::GPA_RANGE: return "gpa index " + bound(p.lo) + ".." + bound(p.hi) + rows;
+            case AccessPath::UNION: break;
+        }
+        std::string s = "union of";
+        for (size_t i = 0; i < p.parts.size(); ++i) s += (i ? " + " : " ") + describe(p.parts[i]);
+        return s;
+    }
+    
+    // Store positions for an index path, in the index's own order
+    void collect(const AccessPath& p, std::vector<std::uint32_t>& out) const {
+        switch (p.kind) {
+            case AccessPath::SCAN:
+                for (size_t i = 0; i < students.size(); ++i) out.push_back(static_cast<std::uint32_t>(i));
+                break;
+            case AccessPath::ROLL_PROBE:
+                for (double r = p.lo; r <= p.hi; ++r) {
+                    auto it = rollIndex.find(static_cast<int>(r));
+                    if (it != rollIndex.end()) out.push_back(static_cast<std::uint32_t>(it->second));
+                }
+                break;
+            case AccessPath::DEPT: {
+                auto it = departments.find(p.dept);
+                if (it == departments.end()) break;
+                for (int roll : it->second.rolls) out.push_back(static_cast<std::uint32_t>(rollIndex.at(roll)));
+                break;
+            }
+            case AccessPath::GPA_RANGE: {
+                auto it = std::isfinite(p.hi)
+                    ? ranking.lower_bound({static_cast<float>(p.hi), std::numeric_limits<int>::min()})
+                    : ranking.begin();
+                for (; it != ranking.end() && it->gpa >= static_cast<float>(p.lo); ++it) {
+                    out.push_back(static_cast<std::uint32_t>(rollIndex.at(it->roll)));
+                }
+                break;
+            }
+            case AccessPath::UNION: {
+                for (const AccessPath& part : p.parts) collect(part, out);
+                std::sort(out.begin(), out.end());
+                out.erase(std::unique(out.begin(), out.end()), out.end());
+                break;
+            }
+        }
+    }
+    
+    // Walks the GPA ranking in batches, best first or worst first; either
+    // way, equal GPAs come out in ascending roll order
+    QueryCursor::Source rankingSource(double lo, double hi, bool bestFirst) const {
+        float flo = static_cast<float>(lo), fhi = static_cast<float>(hi);
+        if (bestFirst) {
+            auto it = std::isfinite(hi) ? ranking.lower_bound({fhi, std::numeric_limits<int>::min()})
+                                        : ranking.begin();
+            return [this, it, flo](std::vector<std::uint32_t>& batch) mutable {
+                batch.clear();
+                for (; it != ranking.end() && it->gpa >= flo && batch.size() < QUERY_BATCH; ++it) {
+                    batch.push_back(static_cast<std::uint32_t>(rollIndex.at(it->roll)));
+                }
+                return it != ranking.end() && it->gpa >= flo;
+            };
+        }
+        // Steps down one GPA at a time and walks each group forwards,
+        // [groupStart, groupEnd), so its rolls still ascend
+        auto cur = std::isfinite(lo) ? ranking.upper_bound({flo, std::numeric_limits<int>::max()})
+                                     : ranking.end();
+        auto groupStart = cur, groupEnd = cur;
+        return [this, cur, groupStart, groupEnd, fhi](std::vector<std::uint32_t>& batch) mutable {
+            auto nextGroup = [&] {
+                return groupStart != ranking.begin() && std::prev(groupStart)->gpa <= fhi;
+            };
+            batch.clear();
+            while (batch.size() < QUERY_BATCH) {
+                if (cur == groupEnd) {
+                    if (!nextGroup()) return false;
+                    groupEnd = groupStart;
+                    groupStart = ranking.lower_bound({std::prev(groupEnd)->gpa, std::numeric_limits<int>::min()});
+                    cur = groupStart;
+                }
+                batch.push_back(static_cast<std::uint32_t>(rollIndex.at(cur->roll)));
+                ++cur;
+            }
+            return cur != groupEnd || nextGroup();
+        };
+    }
+    
+    // Hands out a fixed position list in batches
+    static QueryCursor::Source listSource(std::vector<std::uint32_t> positions) {
+        auto list = std::make_shared<std::vector<std::uint32_t>>(std::move(positions));
+        size_t next = 0;
+        return [list, next](std::vector<std::uint32_t>& batch) mutable {
+            size_t end = std::min(list->size(), next + QUERY_BATCH);
+            batch.assign(list->begin() + next, list->begin() + end);
+            next = end;
+            return next < list->size();
+        };
+    }
+    
+    QueryCursor::Source scanSource() const {
+        size_t next = 0;
+        return [this, next](std::vector<std::uint32_t>& batch) mutable {
+            size_t end = std::min(students.size(), next + QUERY_BATCH);
+            batch.clear();
+            for (; next < end; ++next) batch.push_back(static_cast<std::uint32_t>(next));
+            return next < students.size();
+        };
+    }
+    
+    // ---- on-disk format, version 3 (all integers little-endian) ----
+    //   header: "SDB2" u32 version, u64 records, i32 nextRollNumber, u32 blocks, u32 crc32c
+    //   block:  u32 storedBytes, u32 records, u32 crc32c(stored), u32 rawBytes, u32 codec, stored
+    //           codec 0 stores the payload as is, codec 1 is LzBlock
+    //   payload: varint deptCount, {varint len, dept}, records
+    //   record: varint zigzag(roll - previous roll), varint nameLen, name, varint deptIndex,
+    //           u8 flags, varint gradeCount, grades, [f32 gpa if flags & GPA_STORED]
+    //   grades: GRADES_FIXED: varint zigzag(first), u8 width, bit-packed zigzag deltas,
+    //           all in hundredths; otherwise raw f32 each
+    // Version 2 (fixed-width fields, uncompressed blocks) and version 1
+    // (raw size_t lengths, no checksums) files are still read.
+    //
+    // ---- partitioned layout ----
+    // The store is saved as contiguous slices of up to PARTITION_RECORDS
+    // records, each a version 3 file students.g<generation>.p<index>.dat,
+    // plus students.manifest, which is written last and names the generation:
+    //   manifest: "SDBM" u32 version, u64 records, i32 nextRollNumber, u32 generation,
+    //             u32 partitions, per partition:
+    //               u64 records, i32 minRoll, i32 maxRoll, f32 minGpa, f32 maxGpa,
+    //               u32 deptCount (ANY_DEPT: not listed), {varint len, dept} sorted
+    //             u32 crc32c of everything before it
+    // A single students.dat is still read; the first save replaces it.
+    static constexpr std::uint32_t FILE_VERSION = 3;
+    static constexpr std::uint32_t MANIFEST_VERSION = 1;
+    static constexpr size_t PARTITION_RECORDS = 1 << 17;
+    static constexpr size_t MAX_ZONE_DEPTS = 64;        // more and the manifest does not list them
+    static constexpr std::uint32_t ANY_DEPT = 0xFFFFFFFF;
+    static constexpr size_t MIN_ZONE_BYTES = 32;
+    static constexpr size_t HEADER_BYTES = 28;
+    static constexpr size_t BLOCK_BYTES = 1 << 16;      // target block size when writing
+    static constexpr size_t MAX_BLOCK_BYTES = 1 << 26;  // anything larger is corruption
+    static constexpr size_t MIN_RECORD_BYTES = 20;      // version 2
+    static constexpr size_t MIN_COMPACT_RECORD_BYTES = 5;
+    static constexpr size_t MAX_TEXT_LEN = 1 << 12;
+    static constexpr size_t MAX_GRADES = 1 << 16;
+    static constexpr std::uint32_t CODEC_NONE = 0;
+    static constexpr std::uint32_t CODEC_LZ = 1;
+    static constexpr std::uint8_t GRADES_FIXED = 1;
+    static constexpr std::uint8_t GPA_STORED = 2;
+    static constexpr float GRADE_SCALE = 100.0f;        // fixed-point grades are hundredths
+    static constexpr std::int32_t FIXED_LIMIT = 1 << 24; // floats hold these integers exactly
+    
+    template <typename T>
+    static void put(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    
+    static void putVarint(std::string& out, std::uint64_t value) {
+        for (; value >= 0x80; value >>= 7) out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        out.push_back(static_cast<char>(value));
+    }
+    
+    static std::uint64_t zigzag(std::int64_t v) {
+        return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+    }
+    
+    static std::int64_t unzigzag(std::uint64_t v) {
+        return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+    }
+    // Bounds-checked reads from a buffer; any overrun or bad length clears ok
+    struct ByteReader {
+        const char* p;
+        const char* end;
+        bool ok = true;
+        
+        template <typename T>
+        T get() {
+            T value{};
+            if (static_cast<size_t>(end - p) < sizeof(T)) {
+                ok = false;
+                return value;
+            }
+            std::memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return value;
+        }
+        
+        void getText(std::string& out, std::uint64_t len) {
+            if (len > MAX_TEXT_LEN || static_cast<size_t>(end - p) < len) {
+                ok = false;
+                return;
+            }
+            out.assign(p, len);
+            p += len;
+        }
+        
+        std::uint64_t varint() {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7) {
+                auto byte = static_cast<unsigned char>(*p++);
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            ok = false;
+            return 0;
+        }
+    };
+    
+    // Same arithmetic as Student::calculateGPA, so a GPA that was derived
+    // from the grades need not be stored
+    static float averageGrade(const std::vector<float>& grades) {
+        if (grades.empty()) return 0.0f;
+        double sum = 0;
         for (float g : grades) sum += g;
-        return sum / grades.size();
+        return static_cast<float>(sum / grades.size());
     }
     
-    void updateGPA() {
-        gpa = calculateGPA();
+    // Hundredths for every grade, or false if any grade would not come back
+    // bit-identical (more decimals, huge, NaN, -0)
+    static bool toFixed(const std::vector<float>& grades, std::vector<std::int32_t>& fixed) {
+        fixed.clear();
+        for (float g : grades) {
+            if (!std::isfinite(g) || std::fabs(g) * GRADE_SCALE >= FIXED_LIMIT) return false;
+            auto v = static_cast<std::int32_t>(std::lround(static_cast<double>(g) * GRADE_SCALE));
+            if (static_cast<float>(v) / GRADE_SCALE != g || (v == 0 && std::signbit(g))) return false;
+            fixed.push_back(v);
+        }
+        return true;
     }
-};
-
-class StudentDatabase {
-private:
-    std::vector<Student> students;
-    const std::string filename = "students.dat";
-    int nextRollNumber;
     
-    void saveToFile() {
-        std::ofstream file(filename, std::ios::binary);
-        if (!file) {
-            std::cout << "Error saving data!\n";
-            return;
+    static void encodeCompactRecord(std::string& out, const Student& s, std::int64_t& prevRoll,
+                                    std::uint32_t deptIndex, std::vector<std::int32_t>& fixed) {
+        putVarint(out, zigzag(s.rollNumber - prevRoll));
+        prevRoll = s.rollNumber;
+        putVarint(out, s.name.size());
+        out += s.name;
+        putVarint(out, deptIndex);
+        
+        bool isFixed = toFixed(s.grades, fixed);
+        bool gpaStored = s.gpa != averageGrade(s.grades);
+        out.push_back(static_cast<char>((isFixed ? GRADES_FIXED : 0) | (gpaStored ? GPA_STORED : 0)));
+        putVarint(out, s.grades.size());
+        if (isFixed && !fixed.empty()) {
+            putVarint(out, zigzag(fixed[0]));
+            std::uint64_t used = 0;
+            for (size_t i = 1; i < fixed.size(); ++i) used |= zigzag(std::int64_t(fixed[i]) - fixed[i - 1]);
+            int width = 0;
+            while (used >> width) ++width;
+            out.push_back(static_cast<char>(width));
+            std::uint64_t bits = 0;
+            int pending = 0;
+            for (size_t i = 1; i < fixed.size(); ++i) {
+                bits |= zigzag(std::int64_t(fixed[i]) - fixed[i - 1]) << pending;
+                for (pending += width; pending >= 8; pending -= 8, bits >>= 8) {
+                    out.push_back(static_cast<char>(bits & 0xFF));
+                }
+            }
+            if (pending > 0) out.push_back(static_cast<char>(bits));
+        } else if (!isFixed) {
+            out.append(reinterpret_cast<const char*>(s.grades.data()), s.grades.size() * sizeof(float));
         }
+        if (gpaStored) put<float>(out, s.gpa);
+    }
+    
+    static bool decodeCompactRecord(ByteReader& in, const std::vector<std::string>& depts,
+                                    std::int64_t& prevRoll, Student& s) {
+        std::int64_t roll = prevRoll + unzigzag(in.varint());
+        if (roll < std::numeric_limits<int>::min() || roll > std::numeric_limits<int>::max()) return false;
+        s.rollNumber = static_cast<int>(roll);
+        prevRoll = roll;
+        in.getText(s.name, in.varint());
+        std::uint64_t dept = in.varint();
+        std::uint8_t flags = in.get<std::uint8_t>();
+        std::uint64_t count = in.varint();
+        if (!in.ok || dept >= depts.size() || count > MAX_GRADES || flags > (GRADES_FIXED | GPA_STORED)) return false;
+        s.department = depts[dept];
+        s.grades.resize(count);
         
-        size_t count = students.size();
-        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        if ((flags & GRADES_FIXED) && count > 0) {
+            std::int64_t v = unzigzag(in.varint());
+            int width = in.get<std::uint8_t>();
+            size_t bytes = ((count - 1) * width + 7) / 8;
+            if (!in.ok || width > 32 || static_cast<size_t>(in.end - in.p) < bytes) return false;
+            const auto* packed = reinterpret_cast<const unsigned char*>(in.p);
+            std::uint64_t mask = (std::uint64_t(1) << width) - 1;
+            std::uint64_t bits = 0;
+            int pending = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (i > 0) {
+                    for (; pending < width; pending += 8) bits |= std::uint64_t(*packed++) << pending;
+                    v += unzigzag(bits & mask);
+                    bits >>= width;
+                    pending -= width;
+                }
+                if (v <= -FIXED_LIMIT || v >= FIXED_LIMIT) return false;
+                s.grades[i] = static_cast<float>(v) / GRADE_SCALE;
+            }
+            in.p += bytes;
+        } else if (!(flags & GRADES_FIXED)) {
+            if (static_cast<size_t>(in.end - in.p) < count * sizeof(float)) return false;
+            std::memcpy(s.grades.data(), in.p, count * sizeof(float));
+            in.p += count * sizeof(float);
+        }
+        s.gpa = (flags & GPA_STORED) ? in.get<float>() : averageGrade(s.grades);
+        return in.ok;
+    }
+    
+    // Version 2 record
+    static bool decodeRecord(ByteReader& in, Student& s) {
+        s.rollNumber = in.get<std::int32_t>();
+        in.getText(s.name, in.get<std::uint32_t>());
+        in.getText(s.department, in.get<std::uint32_t>());
+        s.gpa = in.get<float>();
+        std::uint32_t gradeCount = in.get<std::uint32_t>();
+        if (!in.ok || gradeCount > MAX_GRADES ||
+            static_cast<size_t>(in.end - in.p) < gradeCount * sizeof(float)) return false;
+        s.grades.resize(gradeCount);
+        std::memcpy(s.grades.data(), in.p, gradeCount * sizeof(float));
+        in.p += gradeCount * sizeof(float);
+        return true;
+    }
+    
+    // Serialises students[begin, end) as one version 3 file in memory
+    std::string encodeSnapshot(size_t begin, size_t end) const {
+        TRACE_SCOPE("encodeSnapshot");
+        TRACE_RECORDS(end - begin);
+        std::string out(HEADER_BYTES, '\0');
+        std::string body;   // records of the current block
+        std::string raw;    // dictionary + records
+        std::string packed;
+        std::unordered_map<std::string, std::uint32_t> deptIndex; // per block, so blocks decode alone
+        std::vector<const std::string*> deptNames;
+        std::vector<std::int32_t> fixed;
+        std::int64_t prevRoll = 0;
+        std::uint32_t blockRecords = 0;
+        std::uint32_t blockCount = 0;
         
-        for (const auto& s : students) {
-            file.write(reinterpret_cast<const char*>(&s.rollNumber), sizeof(s.rollNumber));
-            
-            size_t nameLen = s.name.length();
-            file.write(reinterpret_cast<const char*>(&nameLen), sizeof(nameLen));
-            file.write(s.name.c_str(), nameLen);
+        auto flushBlock = [&] {
+            if (blockRecords == 0) return;
+            raw.clear();
+            putVarint(raw, deptNames.size());
+            for (const std::string* d : deptNames) {
+                putVarint(raw, d->size());
+                raw += *d;
+            }
+            raw += body;
+            packed.clear();
+            LzBlock::compress(raw.data(), raw.size(), packed);
+            bool useLz = packed.size() < raw.size();
+            const std::string& stored = useLz ? packed : raw;
             
-            size_t deptLen = s.department.length();
-            file.write(reinterpret_cast<const char*>(&deptLen), sizeof(deptLen));
-            file.write(s.department.c_str(), deptLen);
+            put<std::uint32_t>(out, static_cast<std::uint32_t>(stored.size()));
+            put<std::uint32_t>(out, blockRecords);
+            put<std::uint32_t>(out, crc32c(stored.data(), stored.size()));
+            put<std::uint32_t>(out, static_cast<std::uint32_t>(raw.size()));
+            put<std::uint32_t>(out, useLz ? CODEC_LZ : CODEC_NONE);
+            out += stored;
+            body.clear();
+            deptIndex.clear();
+            deptNames.clear();
+            prevRoll = 0;
+            blockRecords = 0;
+            blockCount++;
+        };
+        
+        for (size_t i = begin; i < end; ++i) {
+            const Student& s = students[i];
+            auto it = deptIndex.emplace(s.department, static_cast<std::uint32_t>(deptNames.size())).first;
+            if (it->second == deptNames.size()) deptNames.push_back(&it->first);
+            encodeCompactRecord(body, s, prevRoll, it->second, fixed);
+            blockRecords++;
+            if (body.size() >= BLOCK_BYTES) flushBlock();
+        }
+        flushBlock();
             
-            file.write(reinterpret_cast<const char*>(&s.gpa), sizeof(s.gpa));
+        std::string header = "SDB2";
+        put<std::uint32_t>(header, FILE_VERSION);
+        put<std::uint64_t>(header, end - begin);
+        put<std::int32_t>(header, nextRollNumber);
+        put<std::uint32_t>(header, blockCount);
+        put<std::uint32_t>(header, crc32c(header.data(), header.size()));
+        out.replace(0, HEADER_BYTES, header);
+        return out;
+    }
             
-            size_t gradeCount = s.grades.size();
-            file.write(reinterpret_cast<const char*>(&gradeCount), sizeof(gradeCount));
-            for (float g : s.grades) {
-                file.write(reinterpret_cast<const char*>(&g), sizeof(g));
+    std::string partitionPath(std::uint32_t gen, size_t p) const {
+        return "students.g" + std::to_string(gen) + ".p" + std::to_string(p) + ".dat";
+    }
+    
+    // Highest generation among the partition files in the working directory,
+    // 0 if there are none; `count` is how many there are
+    static std::uint32_t newestGenerationOnDisk(size_t& count) {
+        std::uint32_t newest = 0;
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(".", ec), end; !ec && it != end; it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            unsigned long gen = 0, part = 0;
+            int used = 0;
+            if (std::sscanf(name.c_str(), "students.g%lu.p%lu.dat%n", &gen, &part, &used) == 2 &&
+                static_cast<size_t>(used) == name.size() && gen <= std::numeric_limits<std::uint32_t>::max()) {
+                newest = std::max(newest, static_cast<std::uint32_t>(gen));
+                count++;
+            }
+        }
+        return newest;
+    }
+    
+    // Zone map of students[begin, end)
+    Partition zoneOf(size_t begin, size_t end) const {
+        Partition z;
+        z.records = end - begin;
+        z.minRoll = std::numeric_limits<int>::max();
+        z.maxRoll = std::numeric_limits<int>::min();
+        std::swap(z.minGpa, z.maxGpa);
+        bool anyNan = false;
+        std::set<std::string> depts;
+        z.deptsKnown = true;
+        for (size_t i = begin; i < end; ++i) {
+            const Student& s = students[i];
+            z.minRoll = std::min(z.minRoll, s.rollNumber);
+            z.maxRoll = std::max(z.maxRoll, s.rollNumber);
+            if (std::isnan(s.gpa)) anyNan = true;
+            else {
+                z.minGpa = std::min(z.minGpa, s.gpa);
+                z.maxGpa = std::max(z.maxGpa, s.gpa);
             }
+            if (z.deptsKnown) {
+                depts.insert(s.department);
+                z.deptsKnown = depts.size() <= MAX_ZONE_DEPTS;
+            }
+        }
+        if (anyNan) {
+            z.minGpa = -std::numeric_limits<float>::infinity();
+            z.maxGpa = std::numeric_limits<float>::infinity();
+        }
+        if (z.deptsKnown) z.depts.assign(depts.begin(), depts.end());
+        return z;
+    }
+    
+    std::string encodeManifest(const std::vector<Partition>& zones) const {
+        std::string out = "SDBM";
+        put<std::uint32_t>(out, MANIFEST_VERSION);
+        put<std::uint64_t>(out, students.size());
+        put<std::int32_t>(out, nextRollNumber);
+        put<std::uint32_t>(out, generation);
+        put<std::uint32_t>(out, static_cast<std::uint32_t>(zones.size()));
+        for (const Partition& z : zones) {
+            put<std::uint64_t>(out, z.records);
+            put<std::int32_t>(out, z.minRoll);
+            put<std::int32_t>(out, z.maxRoll);
+            put<float>(out, z.minGpa);
+            put<float>(out, z.maxGpa);
+            put<std::uint32_t>(out, z.deptsKnown ? static_cast<std::uint32_t>(z.depts.size()) : ANY_DEPT);
+            for (const auto& d : z.depts) {
+                putVarint(out, d.size());
+                out += d;
+            }
+        }
+        put<std::uint32_t>(out, crc32c(out.data(), out.size()));
+        return out;
+    }
+    
+    bool decodeManifest(const std::string& data, std::vector<Partition>& parts,
+                        std::int32_t& savedNextRoll, std::uint32_t& savedGeneration) const {
+        if (data.size() < 32 || std::memcmp(data.data(), "SDBM", 4) != 0) return false;
+        size_t body = data.size() - 4;
+        std::uint32_t crc;
+        std::memcpy(&crc, data.data() + body, sizeof(crc));
+        if (crc != crc32c(data.data(), body)) return false;
+        
+        ByteReader in{data.data() + 4, data.data() + body};
+        std::uint32_t version = in.get<std::uint32_t>();
+        std::uint64_t total = in.get<std::uint64_t>();
+        savedNextRoll = in.get<std::int32_t>();
+        savedGeneration = in.get<std::uint32_t>();
+        std::uint32_t count = in.get<std::uint32_t>();
+        if (!in.ok || version != MANIFEST_VERSION || count > body / MIN_ZONE_BYTES) return false;
+        std::uint64_t sum = 0;
+        parts.assign(count, Partition());
+        for (std::uint32_t p = 0; p < count && in.ok; ++p) {
+            Partition& z = parts[p];
+            z.path = partitionPath(savedGeneration, p);
+            z.records = in.get<std::uint64_t>();
+            z.minRoll = in.get<std::int32_t>();
+            z.maxRoll = in.get<std::int32_t>();
+            z.minGpa = in.get<float>();
+            z.maxGpa = in.get<float>();
+            std::uint32_t deptCount = in.get<std::uint32_t>();
+            z.deptsKnown = deptCount != ANY_DEPT;
+            if (z.deptsKnown && deptCount > MAX_ZONE_DEPTS) return false;
+            z.depts.resize(z.deptsKnown ? deptCount : 0);
+            for (auto& d : z.depts) in.getText(d, in.varint());
+            sum += z.records;
+        }
+        return in.ok && in.p == in.end && sum == total;
+    }
+    
+    // True if some record within the zone map could satisfy e
+    static bool mayMatch(const StudentQuery::Expr& e, const Partition& z) {
+        using Expr = StudentQuery::Expr;
+        using Field = StudentQuery::Field;
+        using Op = StudentQuery::Op;
+        if (e.kind == Expr::AND) {
+            for (const Expr& k : e.kids) {
+                if (!mayMatch(k, z)) return false;
+            }
+            return true;
+        }
+        if (e.kind == Expr::OR) {
+            for (const Expr& k : e.kids) {
+                if (mayMatch(k, z)) return true;
+            }
+            return false;
         }
-        file.close();
+        auto overlaps = [&e](double min, double max, double lo, double hi) {
+            switch (e.op) {
+                case Op::EQ: return lo >= min && lo <= max;
+                case Op::LT: return min < lo;
+                case Op::LE: return min <= lo;
+                case Op::GT: return max > lo;
+                case Op::GE: return max >= lo;
+                case Op::BETWEEN: return lo <= max && hi >= min;
+                default: return true;
+            }
+        };
+        switch (e.field) {
+            case Field::ROLL:
+                return overlaps(z.minRoll, z.maxRoll, e.lo, e.hi);
+            case Field::GPA:
+                return overlaps(z.minGpa, z.maxGpa, static_cast<float>(e.lo), static_cast<float>(e.hi));
+            case Field::DEPT:
+                if (!z.deptsKnown) return true;
+                for (const std::string& d : z.depts) {
+                    bool hit = false;
+                    switch (e.op) {
+                        case Op::EQ: hit = d == e.text; break;
+                        case Op::NE: hit = d != e.text; break;
+                        case Op::LT: hit = d < e.text; break;
+                        case Op::LE: hit = d <= e.text; break;
+                        case Op::GT: hit = d > e.text; break;
+                        case Op::GE: hit = d >= e.text; break;
+                        case Op::BETWEEN: hit = d >= e.text && d <= e.textHi; break;
+                        case Op::CONTAINS: hit = d.find(e.text) != std::string::npos; break;
+                    }
+                    if (hit) return true;
+                }
+                return false;
+            default:
+                return true;
+        }
+    }
+    
+    // Encodes the store as partitions in parallel, the manifest last. The
+    // disk writes happen on the writer thread, so the caller can keep
+    // modifying the store right away.
+    SnapshotWriter::Image encodeImage() {
+        const size_t n = students.size();
+        const size_t parts = (n + PARTITION_RECORDS - 1) / PARTITION_RECORDS;
+        generation++;
+        SnapshotWriter::Image image;
+        image.files.resize(parts + 1);
+        std::vector<Partition> zones(parts);
+        pool.forEach(parts, [&](size_t p) {
+            size_t begin = n * p / parts, end = n * (p + 1) / parts;
+            zones[p] = zoneOf(begin, end);
+            image.files[p] = {partitionPath(generation, p), encodeSnapshot(begin, end)};
+        });
+        image.files[parts] = {manifestName, encodeManifest(zones)};
+        return image;
+    }
+    
+    void saveToFile() {
+        TRACE_SCOPE("saveToFile");
+        MEM_SCOPE("StudentDatabase::saveToFile");
+        awaitAll(); // an image without the records still loading would lose them
+        if (writer.takeFailure()) std::cout << "Error saving data!\n";
+        writer.submit(encodeImage());
+        dirty = false;
+    }
+            
+    void addLoaded(Student& s) {
+        s.gradeSum = 0;
+        for (float g : s.grades) s.gradeSum += g;
+        track(s);
+        rollIndex[s.rollNumber] = students.size();
+        rollOrderStale = true;
+        if (s.rollNumber >= nextRollNumber) nextRollNumber = s.rollNumber + 1;
+        students.push_back(std::move(s));
     }
     
-    void loadFromFile() {
+    // ---- lazy, partitioned open ----
+    // The constructor only reads the manifest (or the single file's header);
+    // pool tasks decode the partitions block by block and queue the records.
+    // The interactive thread absorbs queued blocks whenever it needs records
+    // it does not have (awaitRecords, findStudent, awaitMatching) or all of
+    // them (awaitAll), so only loaders touch the files and only the
+    // interactive thread touches the store.
+    
+    void open() {
+        TRACE_SCOPE("open");
+        MEM_SCOPE("StudentDatabase::open");
+        if (openManifest()) return;
         std::ifstream file(filename, std::ios::binary);
         if (!file) return;
+        writer.adopt({filename});
         
-        size_t count;
-        file.read(reinterpret_cast<char*>(&count), sizeof(count));
+        Partition whole;
+        whole.path = filename;
+        char header[HEADER_BYTES];
+        if (!file.read(header, HEADER_BYTES) || std::memcmp(header, "SDB2", 4) != 0) {
+            rollNumbersKnown = false; // version 1 has no header to take them from
+            whole.legacy = true;
+            startLoads({whole});
+            return;
+        }
         
-        for (size_t i = 0; i < count; ++i) {
-            Student s;
-            file.read(reinterpret_cast<char*>(&s.rollNumber), sizeof(s.rollNumber));
-            
-            size_t nameLen;
-            file.read(reinterpret_cast<char*>(&nameLen), sizeof(nameLen));
-            s.name.resize(nameLen);
-            file.read(&s.name[0], nameLen);
-            
-            size_t deptLen;
-            file.read(reinterpret_cast<char*>(&deptLen), sizeof(deptLen));
-            s.department.resize(deptLen);
-            file.read(&s.department[0], deptLen);
-            
-            file.read(reinterpret_cast<char*>(&s.gpa), sizeof(s.gpa));
+        ByteReader h{header + 4, header + HEADER_BYTES};
+        std::uint32_t version = h.get<std::uint32_t>();
+        std::uint64_t expected = h.get<std::uint64_t>();
+        std::int32_t savedNextRoll = h.get<std::int32_t>();
+        h.get<std::uint32_t>(); // block count, read again by the loader
+        std::uint32_t headerCrc = h.get<std::uint32_t>();
+        if (version < 2 || version > FILE_VERSION || headerCrc != crc32c(header, HEADER_BYTES - 4)) {
+            file.close();
+            std::cout << "Warning: " << filename << " has an invalid header; nothing loaded.\n";
+            if (keepDamagedFile(filename)) std::cout << "The original file was kept as " << filename << ".damaged.\n";
+            return;
+        }
+        nextRollNumber = std::max(nextRollNumber, static_cast<int>(savedNextRoll));
+        whole.records = expected;
+        startLoads({whole});
+    }
+    
+    // False if there is no manifest. A damaged one still counts: the single
+    // file, if any, is older than the partitions it described.
+    bool openManifest() {
+        std::ifstream file(manifestName, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        std::string data(static_cast<size_t>(std::max<std::streamoff>(file.tellg(), 0)), '\0');
+        file.seekg(0);
+        std::vector<Partition> parts;
+        std::int32_t savedNextRoll = 0;
+        std::uint32_t savedGeneration = 0;
+        if (!file.read(&data[0], data.size()) || !decodeManifest(data, parts, savedNextRoll, savedGeneration)) {
+            file.close();
+            std::cout << "Warning: " << manifestName << " is damaged; nothing loaded.\n";
+            if (keepDamagedFile(manifestName)) {
+                std::cout << "The original file was kept as " << manifestName << ".damaged.\n";
+            }
+            // The partition files may be the only copy of the records: save
+            // past every generation on disk and never adopt them for removal
+            size_t orphans = 0;
+            generation = newestGenerationOnDisk(orphans);
+            if (orphans) {
+                std::cout << orphans << " partition file(s) (students.g*.p*.dat) were left in place; "
+                          << "the next save will not touch them.\n";
+            }
+            return true;
+        }
+        TRACE_BYTES_READ(data.size());
+        nextRollNumber = std::max(nextRollNumber, static_cast<int>(savedNextRoll));
+        generation = savedGeneration;
+        std::vector<std::string> files{filename}; // left over if the switch from it was interrupted
+        for (const Partition& p : parts) files.push_back(p.path);
+        writer.adopt(std::move(files));
+        startLoads(std::move(parts));
+        return true;
+    }
+    
+    void startLoads(std::vector<Partition> parts) {
+        partitions = std::move(parts);
+        partitionAbsorbed.assign(partitions.size(), 0);
+        demanded.assign(partitions.size(), 0);
+        parked.clear();
+        parked.resize(partitions.size());
+        pendingRecords = 0;
+        for (const Partition& p : partitions) pendingRecords += p.records;
+        if (partitions.empty()) return;
+        std::lock_guard<std::mutex> lock(loadMutex);
+        loadFinished = false;
+        loadsRunning = partitions.size();
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            loadQueue.push_back(p);
+            pool.submit([this] { loadNext(); });
+        }
+    }
+    
+    // Pool task: loads the partition at the front of the queue
+    void loadNext() {
+        size_t p;
+        {
+            std::lock_guard<std::mutex> lock(loadMutex);
+            p = loadQueue.front();
+            loadQueue.pop_front();
+        }
+        if (!loadCancelled) {
+            if (partitions[p].legacy) loadLegacyFile();
+            else loadFromFile(p);
+        }
+        std::lock_guard<std::mutex> lock(loadMutex);
+        loadedChunks.push_back({p, {}, true, {}});
+        if (--loadsRunning == 0) loadFinished = true;
+        loadProgress.notify_all();
+    }
+    
+    // Moves the partitions for which wanted(p) holds to the front of the
+    // load queue and lets their records into the store as soon as they arrive
+    template <typename Pred>
+    void prioritize(Pred wanted) {
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            if (wanted(p)) demanded[p] = 1;
+        }
+        std::lock_guard<std::mutex> lock(loadMutex);
+        std::stable_partition(loadQueue.begin(), loadQueue.end(), wanted);
+    }
+    
+    // Loader: queues one decoded block for the interactive thread
+    void publish(size_t partition, std::vector<Student>& chunk) {
+        QuantileSketch grades;
+        for (const Student& s : chunk) {
+            for (float g : s.grades) grades.add(g);
+        }
+        std::lock_guard<std::mutex> lock(loadMutex);
+        loadedChunks.push_back({partition, std::move(chunk), false, std::move(grades)});
+        loadProgress.notify_all();
+        chunk.clear();
+    }
+    
+    // Loader: queues a warning to print on the interactive thread
+    void note(const std::string& message) {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        loadNotes += message;
+    }
+    
+    // Loader: checks a version 2 or 3 file's header and decodes its blocks
+    void loadFromFile(size_t p) {
+        TRACE_SCOPE("loadFromFile");
+        const std::string& path = partitions[p].path;
+        const std::uint64_t expected = partitions[p].records;
+        std::ifstream file(path, std::ios::binary);
+        char header[HEADER_BYTES];
+        std::uint32_t version = 0;
+        std::uint32_t blockCount = 0;
+        bool damaged = !file.read(header, HEADER_BYTES) || std::memcmp(header, "SDB2", 4) != 0;
+        if (!damaged) {
+            ByteReader h{header + 4, header + HEADER_BYTES};
+            version = h.get<std::uint32_t>();
+            h.get<std::uint64_t>();
+            h.get<std::int32_t>();
+            blockCount = h.get<std::uint32_t>();
+            damaged = version < 2 || version > FILE_VERSION ||
+                      h.get<std::uint32_t>() != crc32c(header, HEADER_BYTES - 4);
+        }
             
-            size_t gradeCount;
-            file.read(reinterpret_cast<char*>(&gradeCount), sizeof(gradeCount));
-            for (size_t j = 0; j < gradeCount; ++j) {
-                float g;
-                file.read(reinterpret_cast<char*>(&g), sizeof(g));
-                s.grades.push_back(g);
+        std::string stored;
+        std::string payload;
+        std::vector<std::string> depts;
+        std::vector<Student> chunk;
+        std::uint64_t loaded = 0;
+        const size_t headerBytes = version >= 3 ? 20 : 12;
+        for (std::uint32_t b = 0; b < blockCount && !damaged && !loadCancelled; ++b) {
+            TRACE_SCOPE("loadBlock");
+            char blockHeader[20];
+            if (!file.read(blockHeader, headerBytes)) {
+                damaged = true;
+                break;
+            }
+            ByteReader bh{blockHeader, blockHeader + headerBytes};
+            std::uint32_t bytes = bh.get<std::uint32_t>();
+            std::uint32_t records = bh.get<std::uint32_t>();
+            std::uint32_t crc = bh.get<std::uint32_t>();
+            std::uint32_t rawBytes = version >= 3 ? bh.get<std::uint32_t>() : bytes;
+            std::uint32_t codec = version >= 3 ? bh.get<std::uint32_t>() : CODEC_NONE;
+            size_t minRecord = version >= 3 ? MIN_COMPACT_RECORD_BYTES : MIN_RECORD_BYTES;
+            if (bytes > MAX_BLOCK_BYTES || rawBytes > MAX_BLOCK_BYTES || records > rawBytes / minRecord ||
+                codec > CODEC_LZ || (codec == CODEC_NONE && rawBytes != bytes)) {
+                damaged = true;
+                break;
+            }
+            stored.resize(bytes);
+            if (!file.read(&stored[0], bytes) || crc32c(stored.data(), bytes) != crc) {
+                damaged = true;
+                break;
+            }
+            TRACE_BYTES_READ(headerBytes + bytes);
+            if (codec == CODEC_LZ) {
+                payload.resize(rawBytes);
+                if (!LzBlock::decompress(stored.data(), bytes, &payload[0], rawBytes)) {
+                    damaged = true;
+                    break;
+                }
+            } else {
+                payload.swap(stored);
             }
             
-            students.push_back(s);
-            if (s.rollNumber >= nextRollNumber) nextRollNumber = s.rollNumber + 1;
+            ByteReader in{payload.data(), payload.data() + rawBytes};
+            std::int64_t prevRoll = 0;
+            if (version >= 3) {
+                std::uint64_t deptCount = in.varint();
+                depts.assign(std::min<std::uint64_t>(deptCount, records), std::string());
+                for (auto& d : depts) in.getText(d, in.varint());
+                if (!in.ok || deptCount > records) {
+                    damaged = true;
+                    break;
+                }
+            }
+            chunk.reserve(records);
+            for (std::uint32_t r = 0; r < records; ++r) {
+                Student s;
+                if (!(version >= 3 ? decodeCompactRecord(in, depts, prevRoll, s) : decodeRecord(in, s))) {
+                    damaged = true;
+                    break;
+                }
+                chunk.push_back(std::move(s));
+            }
+            TRACE_RECORDS(chunk.size());
+            loaded += chunk.size();
+            publish(p, chunk);
+        }
+        
+        if (!loadCancelled && (damaged || loaded != expected)) {
+            file.close();
+            note("Warning: " + path + " is damaged; recovered " + std::to_string(loaded) +
+                 " of " + std::to_string(expected) + " records.\n");
+            if (keepDamagedFile(path)) note("The original file was kept as " + path + ".damaged.\n");
+        }
+    }
+    
+    // The next save would overwrite what could not be recovered
+    static bool keepDamagedFile(const std::string& path) {
+        std::string backup = path + ".damaged";
+        return std::rename(path.c_str(), backup.c_str()) == 0;
+    }
+    
+    // Loader, version 1: size_t count, then raw records with size_t
+    // lengths. Every length is checked against the bytes actually left.
+    void loadLegacyFile() {
+        TRACE_SCOPE("loadLegacyFile");
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        std::string data(static_cast<size_t>(std::max<std::streamoff>(file.tellg(), 0)), '\0');
+        file.seekg(0);
+        if (!file.read(&data[0], data.size())) return;
+        TRACE_BYTES_READ(data.size());
+        
+        ByteReader in{data.data(), data.data() + data.size()};
+        size_t count = in.get<size_t>();
+        size_t loaded = 0;
+        std::vector<Student> chunk;
+        for (size_t i = 0; i < count && in.ok && !loadCancelled; ++i) {
+            Student s;
+            s.rollNumber = in.get<int>();
+            in.getText(s.name, in.get<size_t>());
+            in.getText(s.department, in.get<size_t>());
+            s.gpa = in.get<float>();
+            size_t gradeCount = in.get<size_t>();
+            if (!in.ok || gradeCount > MAX_GRADES ||
+                static_cast<size_t>(in.end - in.p) < gradeCount * sizeof(float)) break;
+            for (size_t j = 0; j < gradeCount; ++j) s.grades.push_back(in.get<float>());
+            chunk.push_back(std::move(s));
+            loaded++;
+            if (chunk.size() == 1024) publish(0, chunk);
+        }
+        publish(0, chunk);
+        TRACE_RECORDS(loaded);
+        if (!loadCancelled && loaded != count) {
+            file.close();
+            note("Warning: " + filename + " is damaged; recovered " + std::to_string(loaded) + " records.\n");
+            if (keepDamagedFile(filename)) note("The original file was kept as " + filename + ".damaged.\n");
+        }
+    }
+    
+    // Moves queued blocks into the store and prints queued warnings.
+    // Blocks wait in their partition's queue until every earlier partition
+    // is in, so the store keeps the saved order, unless their partition was
+    // demanded. Each queue drains strictly in arrival order, which is file
+    // order: one task loads a partition from start to end.
+    void absorbLoaded() {
+        std::string notes;
+        {
+            std::lock_guard<std::mutex> lock(loadMutex);
+            for (auto& chunk : loadedChunks) parked[chunk.partition].push_back(std::move(chunk));
+            loadedChunks.clear();
+            notes.swap(loadNotes);
+        }
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            if (demanded[p]) drainParked(p);
+        }
+        while (nextInOrder < partitions.size()) {
+            drainParked(nextInOrder);
+            if (!partitionAbsorbed[nextInOrder]) break;
+            ++nextInOrder;
+        }
+        if (!notes.empty()) std::cout << notes;
+    }
+    
+    void drainParked(size_t p) {
+        std::deque<LoadedChunk>& queue = parked[p];
+        for (; !queue.empty(); queue.pop_front()) {
+            LoadedChunk& chunk = queue.front();
+            if (chunk.last) {
+                partitionAbsorbed[p] = 1;
+                continue;
+            }
+            if (p != nextInOrder) outOfOrder = true;
+            absorbedSpans.push_back({students.size(), chunk.records.size(), p});
+            for (auto& s : chunk.records) addLoaded(s);
+            gradeSketch.merge(chunk.grades);
+            pendingRecords -= std::min<size_t>(pendingRecords, chunk.records.size());
+        }
+    }
+    
+    // Blocks until a loader queues another block; false once all have finished
+    bool waitForMoreRecords() {
+        std::unique_lock<std::mutex> lock(loadMutex);
+        loadProgress.wait(lock, [this] { return !loadedChunks.empty() || loadFinished; });
+        if (!loadedChunks.empty()) return true;
+        lock.unlock();
+        absorbLoaded(); // warnings queued just before the loaders finished
+        pendingRecords = 0;
+        return false;
+    }
+    
+    // Blocks until at least `count` records are in the store or the files are
+    // exhausted. The first `count` are the saved order's first `count`.
+    void awaitRecords(size_t count) {
+        if (outOfOrder) return awaitAll();
+        absorbLoaded();
+        while (students.size() < count && waitForMoreRecords()) absorbLoaded();
+    }
+    
+    void awaitAll() {
+        TRACE_SCOPE("awaitAll");
+        absorbLoaded();
+        while (waitForMoreRecords()) absorbLoaded();
+        restoreSavedOrder();
+    }
+    
+    // Demanded partitions reach the store ahead of their turn, and records
+    // added while loading land between partitions. Once all are in, put the
+    // records back in saved order; records added in the meantime go last.
+    // Nothing is erased before this runs (deletes and sorts await everything
+    // first), so the spans hold.
+    void restoreSavedOrder() {
+        bool inPlace = !outOfOrder;
+        size_t next = 0;
+        for (const Span& span : absorbedSpans) {
+            inPlace = inPlace && span.start == next;
+            next += span.count;
+        }
+        if (inPlace) {
+            absorbedSpans.clear();
+            return;
+        }
+        outOfOrder = false;
+        std::stable_sort(absorbedSpans.begin(), absorbedSpans.end(),
+                         [](const Span& a, const Span& b) { return a.partition < b.partition; });
+        std::vector<std::uint32_t> order;
+        order.reserve(students.size());
+        std::vector<char> fromFile(students.size(), 0);
+        for (const Span& span : absorbedSpans) {
+            for (size_t i = span.start; i < span.start + span.count; ++i) {
+                order.push_back(static_cast<std::uint32_t>(i));
+                fromFile[i] = 1;
+            }
+        }
+        for (size_t i = 0; i < students.size(); ++i) {
+            if (!fromFile[i]) order.push_back(static_cast<std::uint32_t>(i));
         }
-        file.close();
+        absorbedSpans.clear();
+        if (StudentSorter::permute(students, order)) rebuildRollIndex();
+    }
+    
+    // Blocks until every partition p with needed[p] set is in the store
+    void awaitPartitions(const std::vector<char>& needed) {
+        absorbLoaded();
+        prioritize([&needed](size_t p) { return needed[p] != 0; });
+        auto missing = [&] {
+            for (size_t p = 0; p < partitions.size(); ++p) {
+                if (needed[p] && !partitionAbsorbed[p]) return true;
+            }
+            return false;
+        };
+        while (missing() && waitForMoreRecords()) absorbLoaded();
+    }
+    
+    // Loads the partitions whose zone maps admit a match for q; the others
+    // keep loading in the background. Returns how many were not waited for.
+    size_t awaitMatching(const StudentQuery& q) {
+        absorbLoaded();
+        std::vector<char> needed(partitions.size(), 0);
+        size_t skipped = 0;
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            if (partitionAbsorbed[p]) continue;
+            needed[p] = !q.filtered() || mayMatch(q.where, partitions[p]);
+            skipped += needed[p] ? 0 : 1;
+        }
+        if (skipped == 0) {
+            awaitAll();
+            return 0;
+        }
+        awaitPartitions(needed);
+        return skipped;
+    }
+    
+    // Records still in the file plus those already in memory
+    size_t knownRecordCount() const {
+        return students.size() + pendingRecords;
     }
     
+    // Waits only until the loaders have reached this roll number's block,
+    // and not at all if no partition still loading can hold it
     Student* findStudent(int roll) {
-        for (auto& s : students) {
-            if (s.rollNumber == roll) return &s;
+        TRACE_SCOPE("findStudent");
+        absorbLoaded();
+        auto mayHold = [this, roll](size_t p) {
+            return !partitionAbsorbed[p] && roll >= partitions[p].minRoll && roll <= partitions[p].maxRoll;
+        };
+        bool prioritized = false;
+        while (true) {
+            auto it = rollIndex.find(roll);
+            if (it != rollIndex.end()) return &students[it->second];
+            bool pending = false;
+            for (size_t p = 0; p < partitions.size() && !pending; ++p) pending = mayHold(p);
+            if (!pending) return nullptr;
+            if (!prioritized) {
+                prioritize(mayHold);
+                prioritized = true;
+            }
+            if (!waitForMoreRecords()) return nullptr;
+            absorbLoaded();
         }
-        return nullptr;
     }
     
+    // Appends the record card to screen(); the caller flushes
     void displayStudent(const Student& s) {
-        std::cout << "┌─────────────────────────────────────┐\n";
-        std::cout << "│ Roll: " << std::setw(33) << std::left << s.rollNumber << "│\n";
-        std::cout << "│ Name: " << std::setw(33) << s.name << "│\n";
-        std::cout << "│ Dept: " << std::setw(33) << s.department << "│\n";
-        std::cout << "│ GPA:  " << std::setw(33) << std::fixed << std::setprecision(2) << s.gpa << "│\n";
-        std::cout << "│ Grades: ";
-        for (float g : s.grades) std::cout << g << " ";
-        std::cout << std::string(33 - s.grades.size() * 4, ' ') << "│\n";
-        std::cout << "└─────────────────────────────────────┘\n";
+        static constexpr std::string_view TOP = "┌─────────────────────────────────────┐\n";
+        static constexpr std::string_view BOTTOM = "└─────────────────────────────────────┘\n";
+        OutputBuffer& out = screen();
+        out << TOP;
+        out << "│ Roll: ";
+        out.left(s.rollNumber, 33) << "│\n";
+        out << "│ Name: ";
+        out.left(s.name, 33) << "│\n";
+        out << "│ Dept: ";
+        out.left(s.department, 33) << "│\n";
+        out << "│ GPA:  ";
+        out.left(Fixed{s.gpa, 2}, 33) << "│\n";
+        out << "│ Grades: ";
+        size_t start = out.size();
+        for (float g : s.grades) out << Fixed{g, 2} << " ";
+        size_t written = out.size() - start;
+        out.repeat(" ", written < 31 ? 31 - written : 0) << "│\n";
+        out << BOTTOM;
     }
     
 public:
-    StudentDatabase() : nextRollNumber(1001) {
-        loadFromFile();
+    // Returns as soon as the header is checked; records keep loading in the
+    // background (see open) on `threads` pool workers
+    explicit StudentDatabase(unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+        : pool(threads), nextRollNumber(1001) {
+        open();
     }
     
     ~StudentDatabase() {
-        saveToFile();
+        if (dirty) saveToFile();
+        loadCancelled = true;
+        {
+            std::unique_lock<std::mutex> lock(loadMutex);
+            loadProgress.wait(lock, [this] { return loadFinished; });
+        }
+        writer.wait();
+        if (writer.takeFailure()) std::cout << "Error saving data!\n";
+    }
+    
+    // --check-load: saves `records` generated students (0: enough for a few
+    // partitions) in a scratch directory, then reopens them on a
+    // `threads`-worker pool and checks
+    // that every record comes back in saved order, whether the loaders
+    // are awaited at once, race while the store sits idle, or have a late
+    // partition demanded ahead of the rest. True if every round passes.
+    static bool checkLoad(size_t records, unsigned threads) {
+        namespace fs = std::filesystem;
+        static const char* const DEPTS[] = {"Bio", "CS", "History", "Math", "Physics"};
+        if (records == 0) records = 4 * PARTITION_RECORDS + 1000;
+        std::error_code ec;
+        fs::path home = fs::current_path();
+        fs::path scratch = fs::temp_directory_path(ec) / ("sdb-load-check-" + std::to_string(
+            std::chrono::steady_clock::now().time_since_epoch().count()));
+        if (ec || !fs::create_directories(scratch, ec)) {
+            std::cout << "Could not create a scratch directory.\n";
+            return false;
+        }
+        fs::current_path(scratch);
+        {
+            StudentDatabase db(threads);
+            for (size_t i = 0; i < records; ++i) {
+                Student s;
+                s.rollNumber = static_cast<int>(1001 + i);
+                s.name = "Student " + std::to_string(i);
+                s.department = DEPTS[i % 5];
+                s.grades = {static_cast<float>(40 + i % 61), static_cast<float>(100 - i % 61)};
+                s.gpa = 70;
+                db.addLoaded(s);
+            }
+            db.dirty = true; // saved by the destructor
+        }
+        
+        std::cout << "Reopening " << records << " records on " << threads << " load threads\n";
+        static const char* const ROUNDS[] = {"awaited at once", "idle while loading", "late partition demanded"};
+        bool allPassed = true;
+        for (int round = 0; round < 3; ++round) {
+            StudentDatabase db(threads);
+            if (round == 1) std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            if (round == 2) db.findStudent(static_cast<int>(1000 + records));
+            db.awaitAll();
+            bool ordered = true;
+            for (size_t i = 0; i < db.students.size() && ordered; ++i) {
+                ordered = db.students[i].rollNumber == static_cast<int>(1001 + i);
+            }
+            bool passed = ordered && db.students.size() == records;
+            allPassed = allPassed && passed;
+            std::cout << std::left << std::setw(26) << ROUNDS[round] << std::right << db.students.size()
+                      << " records, " << (ordered ? "in saved order" : "out of order")
+                      << (passed ? "  ok\n" : "  FAIL\n");
+        }
+        fs::current_path(home);
+        fs::remove_all(scratch, ec);
+        return allPassed;
+    }
+    
+    // Programmatic iteration: page size, optional predicate, then skip()
+    // (offset) or after() (keyset) to continue from an earlier page
+    StudentCursor cursor(size_t pageSize, StudentCursor::Filter filter = nullptr) {
+        awaitAll();
+        if (rollOrderStale) {
+            std::vector<std::uint32_t> keys;
+            keys.reserve(students.size());
+            for (const auto& s : students) keys.push_back(StudentSorter::intKey(s.rollNumber));
+            rollOrder = StudentSorter::radixOrder(std::move(keys));
+            rollOrderStale = false;
+        }
+        return StudentCursor(students, pageSize, std::move(filter), &rollOrder);
+    }
+    
+    // Plans and starts a query. Without an order by, results come in store
+    // order whichever access path found them. Ordering by GPA walks the GPA
+    // index, any other order collects the matches and sorts them (partially,
+    // under a limit); ties in the ordering key come in ascending roll order.
+    QueryCursor query(const StudentQuery& q, std::string* plan = nullptr) {
+        TRACE_SCOPE("query");
+        MEM_SCOPE("StudentDatabase::query");
+        using Field = StudentQuery::Field;
+        size_t skipped = awaitMatching(q);
+        AccessPath path = q.filtered() ? planAccess(q.where) : AccessPath();
+        if (path.kind == AccessPath::SCAN) path.estimate = static_cast<double>(students.size());
+        std::string how = describe(path);
+        std::string pruned = skipped ? ", " + std::to_string(skipped) + " of " +
+                                       std::to_string(partitions.size()) + " partitions not read" : "";
+        
+        bool byGpa = q.ordered && q.orderBy == Field::GPA;
+        if (byGpa && (path.kind == AccessPath::SCAN || path.kind == AccessPath::GPA_RANGE)) {
+            // The ranking already holds this order: stream it and stop at the limit
+            if (path.kind == AccessPath::SCAN) how = "gpa index walk";
+            if (plan) *plan = how + pruned + (q.limit ? ", limit " + std::to_string(q.limit) : "");
+            return QueryCursor(students, rankingSource(path.lo, path.hi, q.descending), q.where,
+                               q.filtered(), q.limit);
+        }
+        
+        if (!q.ordered) {
+            if (plan) *plan = how + pruned + (q.limit ? ", limit " + std::to_string(q.limit) : "");
+            if (path.kind == AccessPath::SCAN) {
+                return QueryCursor(students, scanSource(), q.where, q.filtered(), q.limit);
+            }
+            std::vector<std::uint32_t> candidates;
+            collect(path, candidates);
+            std::sort(candidates.begin(), candidates.end()); // index order -> store order
+            return QueryCursor(students, listSource(std::move(candidates)), q.where, q.filtered(), q.limit);
+        }
+        
+        std::vector<std::uint32_t> matches;
+        collect(path, matches);
+        size_t examined = matches.size();
+        TRACE_RECORDS(examined);
+        if (q.filtered()) q.where.narrow(students, matches);
+        
+        const Student* s = students.data();
+        Field key = q.orderBy;
+        bool desc = q.descending;
+        auto before = [s, key, desc](std::uint32_t a, std::uint32_t b) {
+            const Student& x = s[desc ? b : a];
+            const Student& y = s[desc ? a : b];
+            switch (key) {
+                case Field::NAME: if (x.name != y.name) return x.name < y.name; break;
+                case Field::DEPT: if (x.department != y.department) return x.department < y.department; break;
+                case Field::GPA: if (x.gpa != y.gpa) return x.gpa < y.gpa; break;
+                case Field::GRADES: if (x.grades.size() != y.grades.size()) return x.grades.size() < y.grades.size(); break;
+                case Field::ROLL: return x.rollNumber < y.rollNumber;
+            }
+            return s[a].rollNumber < s[b].rollNumber; // ties ascend either way
+        };
+        if (q.limit && q.limit < matches.size()) {
+            std::partial_sort(matches.begin(), matches.begin() + q.limit, matches.end(), before);
+            matches.resize(q.limit);
+            how += ", top-" + std::to_string(q.limit) + " sort";
+        } else {
+            std::sort(matches.begin(), matches.end(), before);
+            how += ", sort";
+        }
+        if (plan) *plan = how + pruned;
+        // The cursor counts the sorted list again as it hands it out
+        examined -= matches.size();
+        return QueryCursor(students, listSource(std::move(matches)), StudentQuery::Expr(), false, 0, examined);
+    }
+    
+    void queryStudents() {
+        std::cout << "Query, e.g.  dept = CS and gpa > 3.5 and grades >= 5 order by gpa desc limit 10\n> ";
+        std::string text;
+        std::cin.ignore();
+        std::getline(std::cin, text);
+        
+        StudentQuery q;
+        std::string error;
+        if (!StudentQuery::parse(text, q, error)) {
+            std::cout << "Invalid query: " << error << "\n";
+            return;
+        }
+        
+        std::string plan;
+        QueryCursor cur = query(q, &plan);
+        OutputBuffer& out = screen();
+        out << "Plan: " << plan << "\n";
+        std::vector<const Student*> page;
+        size_t shown = 0;
+        while (cur.nextPage(page, VIEW_PAGE_SIZE)) {
+            for (const Student* s : page) displayStudent(*s);
+            shown += page.size();
+            if (cur.done()) break;
+            out << "-- " << shown << " shown. [n]ext page / [q]uit: ";
+            out.flush();
+            std::string cmd;
+            if (!(std::cin >> cmd) || cmd == "q" || cmd == "Q") break;
+        }
+        out << shown << " match(es) shown, " << cur.recordsExamined() << " record(s) examined.\n";
+        out.flush();
     }
     
     void addStudent() {
+        MEM_SCOPE("StudentDatabase::addStudent");
+        if (!rollNumbersKnown) awaitAll();
         Student s;
         s.rollNumber = nextRollNumber++;
         
@@ -152,25 +2685,48 @@ public:
             float grade;
             std::cout << "Grade " << (i + 1) << ": ";
             std::cin >> grade;
-            s.grades.push_back(grade);
+            s.addGrade(grade);
         }
         
         s.updateGPA();
+        track(s);
+        for (float g : s.grades) gradeSketch.add(g);
+        rollIndex[s.rollNumber] = students.size();
+        rollOrderStale = true;
         students.push_back(s);
+        dirty = true;
         std::cout << "Student added with Roll Number: " << s.rollNumber << "\n";
     }
     
     void viewAll() {
+        awaitRecords(VIEW_PAGE_SIZE + 1);
         if (students.empty()) {
             std::cout << "No students in database.\n";
             return;
         }
         
-        std::cout << "\n=== ALL STUDENTS ===\n";
-        for (const auto& s : students) {
-            displayStudent(s);
-            std::cout << "\n";
+        OutputBuffer& out = screen();
+        out << "\n=== ALL STUDENTS ===\n";
+        StudentCursor cur(students, VIEW_PAGE_SIZE);
+        std::vector<const Student*> page;
+        size_t shown = 0;
+        while (true) {
+            // One record of lookahead tells the cursor whether another page exists
+            awaitRecords(shown + VIEW_PAGE_SIZE + 1);
+            if (!cur.nextPage(page)) break;
+            for (const Student* s : page) {
+                displayStudent(*s);
+                out << "\n";
+            }
+            shown += page.size();
+            if (cur.done()) break;
+            
+            out << "-- " << shown << " of " << knownRecordCount() << " shown. [n]ext page / [q]uit: ";
+            out.flush();
+            std::string cmd;
+            if (!(std::cin >> cmd) || cmd == "q" || cmd == "Q") break;
         }
+        out.flush();
     }
     
     void searchStudent() {
@@ -184,7 +2740,10 @@ public:
             std::cin >> roll;
             
             Student* s = findStudent(roll);
-            if (s) displayStudent(*s);
+            if (s) {
+                displayStudent(*s);
+                screen().flush();
+            }
             else std::cout << "Student not found.\n";
         }
         else if (choice == 2) {
@@ -193,18 +2752,25 @@ public:
             std::cin.ignore();
             std::getline(std::cin, name);
             
+            TRACE_SCOPE("searchByName");
+            MEM_SCOPE("StudentDatabase::searchByName");
             bool found = false;
-            for (const auto& s : students) {
-                if (s.name.find(name) != std::string::npos) {
-                    displayStudent(s);
-                    found = true;
-                }
+            awaitAll();
+            StudentCursor cur(students, VIEW_PAGE_SIZE,
+                [&name](const Student& s) { return s.name.find(name) != std::string::npos; });
+            std::vector<const Student*> page;
+            while (cur.nextPage(page)) {
+                for (const Student* s : page) displayStudent(*s);
+                screen().flushIfFull();
+                found = true;
             }
+            screen().flush();
             if (!found) std::cout << "No students found.\n";
         }
     }
     
     void updateStudent() {
+        MEM_SCOPE("StudentDatabase::updateStudent");
         int roll;
         std::cout << "Enter roll number to update: ";
         std::cin >> roll;
@@ -217,12 +2783,14 @@ public:
         
         std::cout << "Current info:\n";
         displayStudent(*s);
+        screen().flush();
         
         std::cout << "\nWhat to update?\n";
         std::cout << "1. Name\n2. Department\n3. Add Grade\nChoice: ";
         int choice;
         std::cin >> choice;
         
+        untrack(*s);
         if (choice == 1) {
             std::cout << "Enter new name: ";
             std::cin.ignore();
@@ -237,9 +2805,10 @@ public:
             float grade;
             std::cout << "Enter new grade: ";
             std::cin >> grade;
-            s->grades.push_back(grade);
-            s->updateGPA();
+            s->addGrade(grade);
+            gradeSketch.add(grade);
         }
+        track(*s);
         
         std::cout << "Updated successfully!\n";
         saveToFile();
@@ -250,11 +2819,16 @@ public:
         std::cout << "Enter roll number to delete: ";
         std::cin >> roll;
         
-        auto it = std::remove_if(students.begin(), students.end(),
-            [roll](const Student& s) { return s.rollNumber == roll; });
-        
-        if (it != students.end()) {
-            students.erase(it, students.end());
+        TRACE_SCOPE("deleteStudent");
+        MEM_SCOPE("StudentDatabase::deleteStudent");
+        Student* s = findStudent(roll);
+        if (s) {
+            awaitAll(); // positions must be final before erasing
+            s = findStudent(roll);
+            untrack(*s);
+            gradeSketchStale = true;
+            students.erase(students.begin() + (s - students.data()));
+            rebuildRollIndex();
             std::cout << "Student deleted.\n";
             saveToFile();
         } else {
@@ -267,67 +2841,159 @@ public:
         int choice;
         std::cin >> choice;
         
-        if (choice == 1) {
-            std::sort(students.begin(), students.end(),
-                [](const Student& a, const Student& b) { return a.rollNumber < b.rollNumber; });
-        }
-        else if (choice == 2) {
-            std::sort(students.begin(), students.end(),
-                [](const Student& a, const Student& b) { return a.name < b.name; });
-        }
-        else if (choice == 3) {
-            std::sort(students.begin(), students.end(),
-                [](const Student& a, const Student& b) { return a.gpa > b.gpa; });
+        {
+            TRACE_SCOPE("sortStudents");
+            MEM_SCOPE("StudentDatabase::sortStudents");
+            awaitAll();
+            TRACE_RECORDS(students.size());
+            std::vector<std::uint32_t> keys;
+            if (choice == 1 || choice == 3) {
+                keys.reserve(students.size());
+                for (const auto& s : students) {
+                    // GPA sorts best first: flip the key
+                    keys.push_back(choice == 1 ? StudentSorter::intKey(s.rollNumber) : ~StudentSorter::floatKey(s.gpa));
+                }
+                StudentSorter::permute(students, StudentSorter::radixOrder(std::move(keys)));
+            }
+            else if (choice == 2) {
+                StudentSorter::permute(students, StudentSorter::nameOrder(students));
+            }
+            rebuildRollIndex();
+            dirty = true;
         }
         
         std::cout << "Sorted!\n";
         viewAll();
     }
     
+    // Best `k` students by GPA, in rank order, straight from the running ranking
+    std::vector<const Student*> topStudents(size_t k) {
+        std::vector<const Student*> top;
+        for (auto it = ranking.begin(); it != ranking.end() && top.size() < k; ++it) {
+            top.push_back(findStudent(it->roll));
+        }
+        return top;
+    }
+    
     void generateReport() {
+        TRACE_SCOPE("generateReport");
+        MEM_SCOPE("StudentDatabase::generateReport");
+        awaitAll();
         if (students.empty()) return;
+        TRACE_RECORDS(students.size());
         
-        float totalGPA = 0;
-        float maxGPA = 0;
-        float minGPA = 4.0;
-        std::string topStudent;
+        static constexpr std::string_view HEADER =
+            "\n╔════════════════════════════════════╗\n"
+            "║         CLASS STATISTICS           ║\n"
+            "╠════════════════════════════════════╣\n";
+        static constexpr std::string_view DIVIDER = "╠════════════════════════════════════╣\n";
+        static constexpr std::string_view FOOTER = "╚════════════════════════════════════╝\n";
         
-        for (const auto& s : students) {
-            totalGPA += s.gpa;
-            if (s.gpa > maxGPA) {
-                maxGPA = s.gpa;
-                topStudent = s.name;
+        OutputBuffer& out = screen();
+        out << HEADER;
+        out << "║ Total Students: ";
+        out.right(students.size(), 19) << " ║\n";
+        out << "║ Average GPA:    ";
+        out.right(Fixed{gpaTotal / students.size(), 2}, 19) << " ║\n";
+        out << "║ Highest GPA:    ";
+        out.right(Fixed{ranking.begin()->gpa, 2}, 19) << " ║\n";
+        out << "║ Lowest GPA:     ";
+        out.right(Fixed{ranking.rbegin()->gpa, 2}, 19) << " ║\n";
+        out << "║ Top Student:    ";
+        out.right(findStudent(ranking.begin()->roll)->name, 19) << " ║\n";
+        
+        out << DIVIDER;
+        int rank = 1;
+        for (const Student* s : topStudents(REPORT_TOP_K)) {
+            out << "║ #" << rank++ << " ";
+            out.left(s->name, 24);
+            out.right(Fixed{s->gpa, 2}, 7) << " ║\n";
+        }
+        
+        // From the sketch, not a scan of every grade
+        refreshGradeSketch();
+        if (gradeSketch.size() > 0) {
+            out << DIVIDER;
+            for (int p : REPORT_PERCENTILES) {
+                out << "║ ";
+                out.left(p == 50 ? std::string("Median Grade:") : "Grade p" + std::to_string(p) + ":", 16);
+                out.right(Fixed{gradeSketch.quantile(p / 100.0), 2}, 19) << " ║\n";
             }
-            if (s.gpa < minGPA) minGPA = s.gpa;
         }
         
-        std::cout << "\n╔════════════════════════════════════╗\n";
-        std::cout << "║         CLASS STATISTICS           ║\n";
-        std::cout << "╠════════════════════════════════════╣\n";
-        std::cout << "║ Total Students: " << std::setw(19) << students.size() << " ║\n";
-        std::cout << "║ Average GPA:    " << std::setw(19) << std::fixed << std::setprecision(2) << (totalGPA/students.size()) << " ║\n";
-        std::cout << "║ Highest GPA:    " << std::setw(19) << maxGPA << " ║\n";
-        std::cout << "║ Lowest GPA:     " << std::setw(19) << minGPA << " ║\n";
-        std::cout << "║ Top Student:    " << std::setw(19) << topStudent << " ║\n";
-        std::cout << "╚════════════════════════════════════╝\n";
+        out << DIVIDER;
+        for (const auto& d : departments) {
+            out << "║ ";
+            out.left(d.first, 18);
+            out.right(d.second.count, 6);
+            out.right(Fixed{d.second.gpaTotal / d.second.count, 2}, 10) << " ║\n";
+        }
+        out << FOOTER;
+        
+        out << "\nGrade bands (% of each department's grades)\n";
+        out.left("Department", 12);
+        for (int b = 0; b < GradeHistogram::BANDS; ++b) {
+            out.right(std::to_string(static_cast<int>(b * GradeHistogram::BAND_WIDTH)) + "+", 6);
+        }
+        out.right("other", 7) << "\n";
+        GradeHistogram all;
+        auto bandRow = [&out](const std::string& name, const GradeHistogram& h) {
+            double scale = h.size() ? 100.0 / h.size() : 0;
+            out.left(name, 12);
+            for (int b = 1; b <= GradeHistogram::BANDS; ++b) out.right(Fixed{h.band(b) * scale, 1}, 6);
+            out.right(Fixed{(h.band(GradeHistogram::BELOW) + h.band(GradeHistogram::ABOVE)) * scale, 1}, 7) << "\n";
+        };
+        for (const auto& d : departments) {
+            bandRow(d.first, d.second.grades);
+            all.merge(d.second.grades);
+        }
+        bandRow("All", all);
+        out.flush();
+    }
+    
+    void gradePercentile() {
+        double p;
+        std::cout << "Percentile (0-100): ";
+        std::cin >> p;
+        if (!(p >= 0 && p <= 100)) {
+            std::cout << "Invalid percentile!\n";
+            return;
+        }
+        
+        TRACE_SCOPE("gradePercentile");
+        awaitAll();
+        refreshGradeSketch();
+        if (gradeSketch.size() == 0) {
+            std::cout << "No grades recorded.\n";
+            return;
+        }
+        OutputBuffer& out = screen();
+        out << "Grade at p" << Fixed{p, p == std::floor(p) ? 0 : 2} << ": " << Fixed{gradeSketch.quantile(p / 100.0), 2}
+            << " (of " << gradeSketch.size() << " grades, within about 1% of rank)\n";
+        out.flush();
     }
     
     void run() {
+        static constexpr std::string_view MENU =
+            "\n╔════════════════════════════════════╗\n"
+            "║      STUDENT DATABASE SYSTEM       ║\n"
+            "╠════════════════════════════════════╣\n"
+            "║ 1. Add Student                     ║\n"
+            "║ 2. View All Students               ║\n"
+            "║ 3. Search Student                  ║\n"
+            "║ 4. Update Student                  ║\n"
+            "║ 5. Delete Student                  ║\n"
+            "║ 6. Sort Students                   ║\n"
+            "║ 7. Generate Report                 ║\n"
+            "║ 8. Query Students                  ║\n"
+            "║ 9. Grade Percentile                ║\n"
+            "║ 0. Exit                            ║\n"
+            "╚════════════════════════════════════╝\n"
+            "Choice: ";
         int choice;
         do {
-            std::cout << "\n╔════════════════════════════════════╗\n";
-            std::cout << "║      STUDENT DATABASE SYSTEM       ║\n";
-            std::cout << "╠════════════════════════════════════╣\n";
-            std::cout << "║ 1. Add Student                     ║\n";
-            std::cout << "║ 2. View All Students               ║\n";
-            std::cout << "║ 3. Search Student                  ║\n";
-            std::cout << "║ 4. Update Student                  ║\n";
-            std::cout << "║ 5. Delete Student                  ║\n";
-            std::cout << "║ 6. Sort Students                   ║\n";
-            std::cout << "║ 7. Generate Report                 ║\n";
-            std::cout << "║ 0. Exit                            ║\n";
-            std::cout << "╚════════════════════════════════════╝\n";
-            std::cout << "Choice: ";
+            screen() << MENU;
+            screen().flush();
             std::cin >> choice;
             
             switch(choice) {
@@ -338,7 +3004,12 @@ public:
                 case 5: deleteStudent(); break;
                 case 6: sortStudents(); break;
                 case 7: generateReport(); break;
-                case 0: std::cout << "Saving data...\n"; break;
+                case 8: queryStudents(); break;
+                case 9: gradePercentile(); break;
+                case 0:
+                    std::cout << "Saving data...\n";
+                    if (dirty) saveToFile();
+                    break;
                 default: std::cout << "Invalid choice!\n";
             }
         } while (choice != 0);
@@ -349,21 +3020,77 @@ public:
 // MAIN MENU TO SELECT PROJECT
 // ============================================================
 
-int main() {
+MEM_STATS_HOOK
+
+int main(int argc, char* argv[]) {
+    // --mem-stats: heap, container and per-operation allocation figures at exit
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--mem-stats") == 0 && !MEM_STATS_REQUEST_REPORT()) {
+            std::cerr << "Memory accounting is not built in; rebuild with -DCPP_PROJECTS_MEM_STATS=1.\n";
+        }
+    }
+    
+    // Headless tools: --simulate-guessing [rounds], --guess-server[=socket path],
+    // --check-precision [samples], --bench-precision [calls],
+    // --check-load [records [threads]]
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--check-load") {
+            std::uint64_t records = (i + 1 < argc) ? std::strtoull(argv[i + 1], nullptr, 10) : 0;
+            unsigned threads = (i + 2 < argc) ? static_cast<unsigned>(std::strtoul(argv[i + 2], nullptr, 10)) : 0;
+            return StudentDatabase::checkLoad(records, threads ? std::max(threads, 2u) : 4) ? 0 : 1;
+        }
+        if (arg == "--check-precision" || arg == "--bench-precision") {
+            std::uint64_t count = (i + 1 < argc) ? std::strtoull(argv[i + 1], nullptr, 10) : 0;
+            if (arg == "--bench-precision") {
+                FastMath::benchmark(count ? count : 10000000);
+                return 0;
+            }
+            return FastMath::checkAccuracy(count ? count : 1000000) ? 0 : 1;
+        }
+        if (arg == "--simulate-guessing") {
+            std::uint64_t rounds = (i + 1 < argc) ? std::strtoull(argv[i + 1], nullptr, 10) : 1000000;
+            {
+                MEM_SCOPE("GuessingSimulator::report");
+                GuessingSimulator().report(rounds ? rounds : 1000000);
+            }
+            MEM_STATS_REPORT();
+            return 0;
+        }
+        if (arg == "--guess-server" || arg.rfind("--guess-server=", 0) == 0) {
+            GuessingSessionManager sessions;
+            GuessingServer server(sessions);
+            if (arg == "--guess-server") {
+                std::ios::sync_with_stdio(false);
+                server.serve(std::cin, std::cout);
+                return 0;
+            }
+#if !defined(_WIN32)
+            server.serveUnixSocket(arg.substr(std::strlen("--guess-server=")));
+#endif
+            std::cerr << "Could not serve on " << arg.substr(std::strlen("--guess-server=")) << "\n";
+            return 1;
+        }
+    }
+    
+    static constexpr std::string_view MENU =
+        "\n╔════════════════════════════════════╗\n"
+        "║      C++ PROJECT COLLECTION        ║\n"
+        "╠════════════════════════════════════╣\n"
+        "║ 1. Advanced Calculator             ║\n"
+        "║ 2. Number Guessing Game            ║\n"
+        "║ 3. Tic-Tac-Toe (vs AI)             ║\n"
+        "║ 4. Text Adventure Game             ║\n"
+        "║ 5. Student Database System         ║\n"
+        "║ 0. Exit                            ║\n"
+        "╚════════════════════════════════════╝\n"
+        "Select project: ";
     int choice;
+    std::unique_ptr<StudentDatabase> studentDb;
     
     do {
-        std::cout << "\n╔════════════════════════════════════╗\n";
-        std::cout << "║      C++ PROJECT COLLECTION        ║\n";
-        std::cout << "╠════════════════════════════════════╣\n";
-        std::cout << "║ 1. Advanced Calculator             ║\n";
-        std::cout << "║ 2. Number Guessing Game            ║\n";
-        std::cout << "║ 3. Tic-Tac-Toe (vs AI)             ║\n";
-        std::cout << "║ 4. Text Adventure Game             ║\n";
-        std::cout << "║ 5. Student Database System         ║\n";
-        std::cout << "║ 0. Exit                            ║\n";
-        std::cout << "╚════════════════════════════════════╝\n";
-        std::cout << "Select project: ";
+        screen() << MENU;
+        screen().flush();
         std::cin >> choice;
         
         switch(choice) {
@@ -388,8 +3115,9 @@ int main() {
                 break;
             }
             case 5: {
-                StudentDatabase db;
-                db.run();
+                // Opened once and kept warm across menu visits
+                if (!studentDb) studentDb = std::make_unique<StudentDatabase>();
+                studentDb->run();
                 break;
             }
             case 0:
@@ -400,5 +3128,9 @@ int main() {
         }
     } while (choice != 0);
     
+    studentDb.reset(); // waits for the loads and the writer before reporting
+    TRACE_REPORT("trace.json");
+    MEM_STATS_REPORT();
+    
     return 0;
 }
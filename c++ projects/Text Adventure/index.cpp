@@ -4,11 +4,18 @@
 // ============================================================
 
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "../common/output_buffer.h"
+#include "../common/mem_stats.h"
 
 class AdventureGame {
 private:
@@ -16,90 +23,393 @@ private:
         std::string name;
         std::string description;
         std::map<std::string, int> exits; // direction -> room index
-        std::vector<std::string> items;
-        bool visited;
+        std::vector<int> items;           // item ids placed here at the start
+        std::map<std::string, std::pair<int, int>> lockedExits{}; // direction -> (room, flag that opens it)
     };
     
-    std::vector<Room> rooms;
-    std::vector<std::string> inventory;
-    int currentRoom;
-    int moves;
-    bool gameOver;
+    // ---- rule engine ----
+    // Using `item` in a room fires the first rule for (item, room) whose flag
+    // conditions hold, else the first such rule for (item, ANY_ROOM). Rules
+    // with the same trigger are contiguous; conditions and actions live in
+    // flat arrays that the rule indexes into.
     
-    void initializeWorld() {
-        rooms = {
+    enum class ActionKind : std::uint8_t { SAY, MOVE_ITEM, SET_FLAG, CLEAR_FLAG, WIN };
+    
+    struct Action {
+        ActionKind kind;
+        int item;         // MOVE_ITEM
+        int target;       // MOVE_ITEM: room, INVENTORY or NOWHERE; SET/CLEAR_FLAG: flag
+        std::string text; // SAY
+    };
+    
+    struct Condition {
+        int flag;
+        bool set;
+    };
+    
+    struct Rule {
+        std::uint64_t trigger;
+        std::uint32_t firstCondition, conditionCount;
+        std::uint32_t firstAction, actionCount;
+    };
+    
+    // Open-addressing hash table: trigger -> run of rules in World::rules
+    class RuleTable {
+    private:
+        struct Slot {
+            std::uint64_t trigger = EMPTY;
+            std::uint32_t first = 0;
+            std::uint32_t count = 0;
+        };
+        static constexpr std::uint64_t EMPTY = ~std::uint64_t(0);
+        
+        std::vector<Slot> slots; // power-of-two size, at most half full
+        int shift = 64;
+        
+        size_t home(std::uint64_t trigger) const {
+            return static_cast<size_t>((trigger * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+        
+    public:
+        static std::uint64_t triggerOf(int item, int room) {
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(item)) << 32) |
+                   static_cast<std::uint32_t>(room + 1);
+        }
+        
+        // `rules` must be sorted by trigger
+        void build(const std::vector<Rule>& rules) {
+            size_t capacity = 2;
+            shift = 63;
+            while (capacity < rules.size() * 2) {
+                capacity <<= 1;
+                shift--;
+            }
+            slots.assign(capacity, Slot());
+            for (std::uint32_t i = 0; i < rules.size(); ++i) {
+                size_t s = home(rules[i].trigger);
+                while (slots[s].trigger != EMPTY && slots[s].trigger != rules[i].trigger) {
+                    s = (s + 1) & (capacity - 1);
+                }
+                if (slots[s].trigger == EMPTY) slots[s] = {rules[i].trigger, i, 0};
+                slots[s].count++;
+            }
+        }
+        
+        // Rules with this trigger as [first, first + count); count 0 if none
+        std::pair<std::uint32_t, std::uint32_t> find(std::uint64_t trigger) const {
+            if (slots.empty()) return {0, 0};
+            for (size_t s = home(trigger);; s = (s + 1) & (slots.size() - 1)) {
+                if (slots[s].trigger == trigger) return {slots[s].first, slots[s].count};
+                if (slots[s].trigger == EMPTY) return {0, 0};
+            }
+        }
+    };
+    
+    // Tag for --mem-stats: the world's room table
+    struct RoomsMemory {
+        static constexpr const char* name = "AdventureGame::rooms";
+    };
+    
+    // Static world definition, shared by every session and every fork
+    struct World {
+        std::vector<Room, TrackingAllocator<Room, RoomsMemory>> rooms;
+        std::vector<std::string> itemNames; // item id -> name
+        std::unordered_map<std::string, int> itemIds;
+        std::vector<std::string> flagNames; // flag id -> name
+        std::vector<Rule> rules;
+        std::vector<Condition> conditions;
+        std::vector<Action> actions;
+        RuleTable ruleTable;
+    };
+    
+    // Everything a session can change. Forks share one State until either
+    // side writes to it (see mutableState).
+    struct State {
+        std::vector<std::vector<int>> roomItems; // room index -> item ids
+        std::vector<int> inventory;
+        std::vector<bool> visited;
+        std::vector<bool> flags;                 // flag id -> set
+        int currentRoom;
+        int moves;
+        bool gameOver;
+    };
+    
+    static constexpr std::uint8_t SNAPSHOT_VERSION = 2;
+    static constexpr int NOWHERE = -1;   // location of an item taken out of the world
+    static constexpr int INVENTORY = -2; // MOVE_ITEM target: the player's hands
+    static constexpr int ANY_ROOM = -1;  // rule trigger room matching every room
+    
+    // World interactions, compiled by compileRules. One rule per line:
+    //   <item> <room index|*> [+flag|-flag]... : <action>; <action>...
+    // actions: say <text> | move <item> <room index|inventory|gone>
+    //          | set <flag> | clear <flag> | unlock <room> <direction> <to room> | win
+    static constexpr const char* RULES =
+        "key 2 : say You unlock the cave door with the key!; say Inside, you find ancient treasure! YOU WIN!; win\n"
+        "torch * : say The torch lights up the area. You can see better now.\n"
+        "sword * : say You swing the sword. It feels powerful in your hands.\n";
+    
+    std::shared_ptr<const World> world;
+    std::shared_ptr<State> state;
+    
+    static std::shared_ptr<const World> buildWorld() {
+        auto w = std::make_shared<World>();
+        w->itemNames = {"key", "torch", "sword"};
+        w->rooms = {
             {
                 "Forest Entrance",
                 "You stand at the edge of a dark forest. A path leads north into the woods.\n"
                 "There's a rusty KEY on the ground.",
                 {{"north", 1}},
-                {"key"},
-                false
+                {0}
             },
             {
                 "Dark Woods",
                 "Tall trees block out the sunlight. You hear strange noises.\n"
                 "Paths lead: south (back), east, west. There's a TORCH here.",
                 {{"south", 0}, {"east", 2}, {"west", 3}},
-                {"torch"},
-                false
+                {1}
             },
             {
                 "Cave Mouth",
                 "A dark cave entrance. You feel cold air coming from within.\n"
                 "The cave is locked with a heavy door.",
                 {{"west", 1}},
-                {},
-                false
+                {}
             },
             {
                 "Crystal Lake",
                 "A serene lake shimmers in a clearing. Something glitters at the bottom.\n"
                 "There's a SWORD stuck in a stone.",
                 {{"east", 1}},
-                {"sword"},
-                false
+                {2}
             }
         };
-        currentRoom = 0;
-        moves = 0;
-        gameOver = false;
+        for (size_t i = 0; i < w->itemNames.size(); ++i) w->itemIds[w->itemNames[i]] = static_cast<int>(i);
+        std::string error;
+        if (!compileRules(*w, RULES, error)) std::cout << "Error in world rules: " << error << "\n";
+        return w;
+    }
+    
+    static int flagId(World& w, const std::string& name) {
+        auto it = std::find(w.flagNames.begin(), w.flagNames.end(), name);
+        if (it != w.flagNames.end()) return static_cast<int>(it - w.flagNames.begin());
+        w.flagNames.push_back(name);
+        return static_cast<int>(w.flagNames.size()) - 1;
+    }
+    
+    // Parses RULES-style text into w.rules/conditions/actions and indexes the
+    // triggers. Rooms are indices into w.rooms; flags are created on first use.
+    static bool compileRules(World& w, const std::string& text, std::string& error) {
+        std::vector<std::pair<Rule, int>> parsed; // rule, line (keeps file order within a trigger)
+        std::istringstream lines(text);
+        std::string line;
+        for (int lineNo = 1; std::getline(lines, line); ++lineNo) {
+            if (line.find_first_not_of(" \t") == std::string::npos || line[0] == '#') continue;
+            auto fail = [&](const std::string& why) {
+                error = "line " + std::to_string(lineNo) + ": " + why;
+                return false;
+            };
+            auto room = [&](const std::string& s, int& out) {
+                char* end = nullptr;
+                long r = std::strtol(s.c_str(), &end, 10);
+                if (s.empty() || *end != '\0' || r < 0 || r >= static_cast<long>(w.rooms.size())) return false;
+                out = static_cast<int>(r);
+                return true;
+            };
+            
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) return fail("missing ':'");
+            std::istringstream head(line.substr(0, colon));
+            std::string itemName, roomName, cond;
+            if (!(head >> itemName >> roomName)) return fail("expected '<item> <room>'");
+            auto item = w.itemIds.find(itemName);
+            if (item == w.itemIds.end()) return fail("unknown item '" + itemName + "'");
+            int where = ANY_ROOM;
+            if (roomName != "*" && !room(roomName, where)) return fail("bad room '" + roomName + "'");
+            
+            Rule rule;
+            rule.trigger = RuleTable::triggerOf(item->second, where);
+            rule.firstCondition = static_cast<std::uint32_t>(w.conditions.size());
+            while (head >> cond) {
+                if (cond.size() < 2 || (cond[0] != '+' && cond[0] != '-')) return fail("bad condition '" + cond + "'");
+                w.conditions.push_back({flagId(w, cond.substr(1)), cond[0] == '+'});
+            }
+            rule.conditionCount = static_cast<std::uint32_t>(w.conditions.size()) - rule.firstCondition;
+            
+            rule.firstAction = static_cast<std::uint32_t>(w.actions.size());
+            std::istringstream body(line.substr(colon + 1));
+            std::string step;
+            while (std::getline(body, step, ';')) {
+                std::istringstream words(step);
+                std::string verb, a, b, c;
+                if (!(words >> verb)) continue;
+                Action act{ActionKind::SAY, NOWHERE, NOWHERE, ""};
+                if (verb == "say") {
+                    std::getline(words >> std::ws, act.text);
+                } else if (verb == "move" && words >> a >> b) {
+                    auto moved = w.itemIds.find(a);
+                    if (moved == w.itemIds.end()) return fail("unknown item '" + a + "'");
+                    act.kind = ActionKind::MOVE_ITEM;
+                    act.item = moved->second;
+                    if (b == "inventory") act.target = INVENTORY;
+                    else if (b != "gone" && !room(b, act.target)) return fail("bad room '" + b + "'");
+                } else if ((verb == "set" || verb == "clear") && words >> a) {
+                    act.kind = verb == "set" ? ActionKind::SET_FLAG : ActionKind::CLEAR_FLAG;
+                    act.target = flagId(w, a);
+                } else if (verb == "unlock" && words >> a >> b >> c) {
+                    int from, to;
+                    if (!room(a, from) || !room(c, to)) return fail("bad room in unlock");
+                    int flag = flagId(w, "exit:" + a + ":" + b);
+                    w.rooms[from].lockedExits[b] = {to, flag};
+                    act.kind = ActionKind::SET_FLAG;
+                    act.target = flag;
+                } else if (verb == "win") {
+                    act.kind = ActionKind::WIN;
+                } else {
+                    return fail("bad action '" + step + "'");
+                }
+                w.actions.push_back(std::move(act));
+            }
+            rule.actionCount = static_cast<std::uint32_t>(w.actions.size()) - rule.firstAction;
+            parsed.push_back({rule, lineNo});
+        }
+        
+        std::stable_sort(parsed.begin(), parsed.end(),
+            [](const std::pair<Rule, int>& x, const std::pair<Rule, int>& y) { return x.first.trigger < y.first.trigger; });
+        for (const auto& p : parsed) w.rules.push_back(p.first);
+        w.ruleTable.build(w.rules);
+        return true;
+    }
+    
+    void initializeWorld() {
+        static const std::shared_ptr<const World> defaultWorld = buildWorld();
+        world = defaultWorld;
+        state = std::make_shared<State>(initialState());
+    }
+    
+    State initialState() const {
+        State s;
+        for (const auto& room : world->rooms) s.roomItems.push_back(room.items);
+        s.visited.assign(world->rooms.size(), false);
+        s.flags.assign(world->flagNames.size(), false);
+        s.currentRoom = 0;
+        s.moves = 0;
+        s.gameOver = false;
+        return s;
+    }
+    
+    // Copy-on-write: detach from any fork before the first write
+    State& mutableState() {
+        if (state.use_count() > 1) state = std::make_shared<State>(*state);
+        return *state;
+    }
+    
+    // Read-only view; never detaches a fork
+    const State& currentState() const { return *state; }
+    
+    int itemId(const std::string& name) const {
+        auto it = world->itemIds.find(name);
+        return it == world->itemIds.end() ? NOWHERE : it->second;
+    }
+    
+    int initialLocation(int item) const {
+        for (size_t r = 0; r < world->rooms.size(); ++r) {
+            const auto& items = world->rooms[r].items;
+            if (std::find(items.begin(), items.end(), item) != items.end()) return static_cast<int>(r);
+        }
+        return NOWHERE;
+    }
+    
+    // ---- snapshot encoding helpers ----
+    
+    static void putVarint(std::vector<std::uint8_t>& out, std::uint32_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(v));
+    }
+    
+    static bool getVarint(const std::vector<std::uint8_t>& in, size_t& pos, std::uint32_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 35 && pos < in.size(); shift += 7) {
+            std::uint8_t byte = in[pos++];
+            v |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+    
+    // Count, then the bits packed LSB first
+    static void putBits(std::vector<std::uint8_t>& out, const std::vector<bool>& bits) {
+        putVarint(out, static_cast<std::uint32_t>(bits.size()));
+        std::vector<std::uint8_t> packed((bits.size() + 7) / 8, 0);
+        for (size_t i = 0; i < bits.size(); ++i) {
+            if (bits[i]) packed[i / 8] |= static_cast<std::uint8_t>(1u << (i % 8));
+        }
+        out.insert(out.end(), packed.begin(), packed.end());
+    }
+    
+    // Reads bits written by putBits; the count must match bits.size()
+    static bool getBits(const std::vector<std::uint8_t>& in, size_t& pos, size_t end, std::vector<bool>& bits) {
+        std::uint32_t count;
+        if (!getVarint(in, pos, count) || count != bits.size() || pos + (count + 7) / 8 > end) return false;
+        for (size_t i = 0; i < count; ++i) bits[i] = (in[pos + i / 8] >> (i % 8)) & 1;
+        pos += (count + 7) / 8;
+        return true;
+    }
+    
+    static std::uint32_t checksum(const std::uint8_t* data, size_t len) {
+        std::uint32_t h = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < len; ++i) {
+            h ^= data[i];
+            h *= 16777619u;
+        }
+        return h;
     }
     
     void displayRoom() {
-        Room& room = rooms[currentRoom];
+        const State& st = currentState();
+        const Room& room = world->rooms[st.currentRoom];
+        OutputBuffer& out = screen();
         
-        if (!room.visited) {
-            std::cout << "\n" << room.name << "\n";
-            std::cout << std::string(room.name.length(), '=') << "\n";
-            std::cout << room.description << "\n";
-            room.visited = true;
+        if (!st.visited[st.currentRoom]) {
+            out << "\n" << room.name << "\n";
+            out.repeat("=", room.name.length()) << "\n";
+            out << room.description << "\n";
+            mutableState().visited[st.currentRoom] = true;
         } else {
-            std::cout << "\n[" << room.name << "]\n";
+            out << "\n[" << room.name << "]\n";
         }
         
-        if (!room.items.empty()) {
-            std::cout << "Items here: ";
-            for (const auto& item : room.items) std::cout << item << " ";
-            std::cout << "\n";
+        const auto& items = st.roomItems[st.currentRoom];
+        if (!items.empty()) {
+            out << "Items here: ";
+            for (int item : items) out << world->itemNames[item] << " ";
+            out << "\n";
         }
         
-        std::cout << "Exits: ";
-        for (const auto& exit : room.exits) std::cout << exit.first << " ";
-        std::cout << "\n";
+        out << "Exits: ";
+        for (const auto& exit : room.exits) out << exit.first << " ";
+        for (const auto& exit : room.lockedExits) {
+            if (st.flags[exit.second.second]) out << exit.first << " ";
+        }
+        out << "\n";
     }
     
     void showInventory() {
-        if (inventory.empty()) {
-            std::cout << "Your inventory is empty.\n";
+        OutputBuffer& out = screen();
+        if (state->inventory.empty()) {
+            out << "Your inventory is empty.\n";
         } else {
-            std::cout << "You carry: ";
-            for (const auto& item : inventory) std::cout << item << " ";
-            std::cout << "\n";
+            out << "You carry: ";
+            for (int item : state->inventory) out << world->itemNames[item] << " ";
+            out << "\n";
         }
     }
     
     void parseCommand(const std::string& input) {
+        MEM_SCOPE("AdventureGame::command");
         std::istringstream iss(input);
         std::vector<std::string> tokens;
         std::string token;
@@ -114,7 +424,7 @@ private:
         
         if (cmd == "go" || cmd == "move") {
             if (tokens.size() < 2) {
-                std::cout << "Go where?\n";
+                screen() << "Go where?\n";
                 return;
             }
             move(tokens[1]);
@@ -130,14 +440,14 @@ private:
         }
         else if (cmd == "take" || cmd == "get") {
             if (tokens.size() < 2) {
-                std::cout << "Take what?\n";
+                screen() << "Take what?\n";
                 return;
             }
             take(tokens[1]);
         }
         else if (cmd == "drop") {
             if (tokens.size() < 2) {
-                std::cout << "Drop what?\n";
+                screen() << "Drop what?\n";
                 return;
             }
             drop(tokens[1]);
@@ -146,114 +456,322 @@ private:
             showInventory();
         }
         else if (cmd == "look" || cmd == "l") {
-            rooms[currentRoom].visited = false;
+            mutableState().visited[state->currentRoom] = false;
             displayRoom();
         }
         else if (cmd == "use") {
             if (tokens.size() < 2) {
-                std::cout << "Use what?\n";
+                screen() << "Use what?\n";
                 return;
             }
             use(tokens[1]);
         }
+        else if (cmd == "save") {
+            saveGame(tokens.size() < 2 ? "adventure.sav" : tokens[1]);
+        }
+        else if (cmd == "load") {
+            loadGame(tokens.size() < 2 ? "adventure.sav" : tokens[1]);
+        }
         else if (cmd == "help" || cmd == "?") {
             showHelp();
         }
         else if (cmd == "quit" || cmd == "exit") {
-            gameOver = true;
+            mutableState().gameOver = true;
         }
         else {
-            std::cout << "I don't understand that command. Type 'help' for commands.\n";
+            screen() << "I don't understand that command. Type 'help' for commands.\n";
         }
     }
     
     void move(const std::string& direction) {
-        Room& room = rooms[currentRoom];
+        const Room& room = world->rooms[state->currentRoom];
+        int to = NOWHERE;
         auto it = room.exits.find(direction);
         if (it != room.exits.end()) {
-            currentRoom = it->second;
-            moves++;
+            to = it->second;
+        } else {
+            auto locked = room.lockedExits.find(direction);
+            if (locked != room.lockedExits.end() && state->flags[locked->second.second]) to = locked->second.first;
+        }
+        if (to != NOWHERE) {
+            State& st = mutableState();
+            st.currentRoom = to;
+            st.moves++;
             displayRoom();
         } else {
-            std::cout << "You can't go that way.\n";
+            screen() << "You can't go that way.\n";
         }
     }
     
     void take(const std::string& item) {
-        Room& room = rooms[currentRoom];
-        auto it = std::find(room.items.begin(), room.items.end(), item);
-        if (it != room.items.end()) {
-            inventory.push_back(item);
-            room.items.erase(it);
-            std::cout << "You take the " << item << ".\n";
+        int id = itemId(item);
+        const auto& here = state->roomItems[state->currentRoom];
+        if (id != NOWHERE && std::find(here.begin(), here.end(), id) != here.end()) {
+            State& st = mutableState();
+            auto& items = st.roomItems[st.currentRoom];
+            st.inventory.push_back(id);
+            items.erase(std::find(items.begin(), items.end(), id));
+            screen() << "You take the " << item << ".\n";
         } else {
-            std::cout << "There's no " << item << " here.\n";
+            screen() << "There's no " << item << " here.\n";
         }
     }
     
     void drop(const std::string& item) {
-        auto it = std::find(inventory.begin(), inventory.end(), item);
-        if (it != inventory.end()) {
-            rooms[currentRoom].items.push_back(item);
-            inventory.erase(it);
-            std::cout << "You drop the " << item << ".\n";
+        int id = itemId(item);
+        const auto& carried = state->inventory;
+        if (id != NOWHERE && std::find(carried.begin(), carried.end(), id) != carried.end()) {
+            State& st = mutableState();
+            st.roomItems[st.currentRoom].push_back(id);
+            st.inventory.erase(std::find(st.inventory.begin(), st.inventory.end(), id));
+            screen() << "You drop the " << item << ".\n";
         } else {
-            std::cout << "You don't have a " << item << ".\n";
+            screen() << "You don't have a " << item << ".\n";
         }
     }
     
     void use(const std::string& item) {
-        if (std::find(inventory.begin(), inventory.end(), item) == inventory.end()) {
-            std::cout << "You don't have a " << item << ".\n";
+        const auto& carried = state->inventory;
+        if (std::find(carried.begin(), carried.end(), itemId(item)) == carried.end()) {
+            screen() << "You don't have a " << item << ".\n";
             return;
         }
         
-        if (item == "key" && currentRoom == 2) {
-            std::cout << "You unlock the cave door with the key!\n";
-            std::cout << "Inside, you find ancient treasure! YOU WIN!\n";
-            std::cout << "Completed in " << moves << " moves.\n";
-            gameOver = true;
+        const Rule* rule = findRule(itemId(item), state->currentRoom);
+        if (!rule) rule = findRule(itemId(item), ANY_ROOM);
+        if (!rule) {
+            screen() << "You can't use that here.\n";
+            return;
         }
-        else if (item == "torch") {
-            std::cout << "The torch lights up the area. You can see better now.\n";
+        for (std::uint32_t a = rule->firstAction; a < rule->firstAction + rule->actionCount; ++a) {
+            runAction(world->actions[a]);
         }
-        else if (item == "sword") {
-            std::cout << "You swing the sword. It feels powerful in your hands.\n";
+    }
+    
+    // First rule for this trigger whose flag conditions hold
+    const Rule* findRule(int item, int room) const {
+        auto run = world->ruleTable.find(RuleTable::triggerOf(item, room));
+        for (std::uint32_t r = run.first; r < run.first + run.second; ++r) {
+            const Rule& rule = world->rules[r];
+            bool holds = true;
+            for (std::uint32_t c = rule.firstCondition; holds && c < rule.firstCondition + rule.conditionCount; ++c) {
+                const Condition& cond = world->conditions[c];
+                holds = state->flags[cond.flag] == cond.set;
+            }
+            if (holds) return &rule;
         }
-        else {
-            std::cout << "You can't use that here.\n";
+        return nullptr;
+    }
+    
+    void runAction(const Action& act) {
+        switch (act.kind) {
+            case ActionKind::SAY:
+                screen() << act.text << "\n";
+                break;
+            case ActionKind::MOVE_ITEM: {
+                State& st = mutableState();
+                for (auto& items : st.roomItems) items.erase(std::remove(items.begin(), items.end(), act.item), items.end());
+                st.inventory.erase(std::remove(st.inventory.begin(), st.inventory.end(), act.item), st.inventory.end());
+                if (act.target == INVENTORY) st.inventory.push_back(act.item);
+                else if (act.target != NOWHERE) st.roomItems[act.target].push_back(act.item);
+                break;
+            }
+            case ActionKind::SET_FLAG:
+            case ActionKind::CLEAR_FLAG:
+                mutableState().flags[act.target] = act.kind == ActionKind::SET_FLAG;
+                break;
+            case ActionKind::WIN:
+                screen() << "Completed in " << state->moves << " moves.\n";
+                mutableState().gameOver = true;
+                break;
         }
     }
     
-    void showHelp() {
-        std::cout << "\nCommands:\n";
-        std::cout << "  go [direction] / [n/s/e/w] - Move\n";
-        std::cout << "  take [item]    - Pick up item\n";
-        std::cout << "  drop [item]    - Drop item\n";
-        std::cout << "  use [item]     - Use item\n";
-        std::cout << "  inventory (i)  - Show items\n";
-        std::cout << "  look (l)       - Look around\n";
-        std::cout << "  help (?)       - Show help\n";
-        std::cout << "  quit           - Exit game\n";
+    void saveGame(const std::string& path) {
+        std::vector<std::uint8_t> data = saveSnapshot();
+        std::ofstream file(path, std::ios::binary);
+        if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            screen() << "Error saving game!\n";
+            return;
+        }
+        screen() << "Game saved to " << path << " (" << data.size() << " bytes).\n";
     }
     
+    void loadGame(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                       std::istreambuf_iterator<char>());
+        if (!file.is_open() || !loadSnapshot(data)) {
+            screen() << "Could not load a saved game from " << path << ".\n";
+            return;
+        }
+        screen() << "Game loaded.\n";
+        mutableState().visited[state->currentRoom] = false;
+        displayRoom();
+    }
+    
+    void showHelp() {
+        static constexpr std::string_view HELP =
+            "\nCommands:\n"
+            "  go [direction] / [n/s/e/w] - Move\n"
+            "  take [item]    - Pick up item\n"
+            "  drop [item]    - Drop item\n"
+            "  use [item]     - Use item\n"
+            "  inventory (i)  - Show items\n"
+            "  look (l)       - Look around\n"
+            "  save [file]    - Save the game\n"
+            "  load [file]    - Load a saved game\n"
+            "  help (?)       - Show help\n"
+            "  quit           - Exit game\n";
+        screen() << HELP;
+    }
+
 public:
-    void play() {
+    AdventureGame() {
         initializeWorld();
-        std::cout << "╔══════════════════════════════════════╗\n";
-        std::cout << "║     THE CRYSTAL CAVE ADVENTURE       ║\n";
-        std::cout << "╚══════════════════════════════════════╝\n";
-        std::cout << "Find the treasure hidden in the cave!\n";
-        std::cout << "Type 'help' for commands.\n";
+    }
+    
+    // Runs one command line against this session (for replay/solver tooling).
+    // Returns false once the game is over.
+    bool execute(const std::string& command) {
+        parseCommand(command);
+        screen().flush();
+        return !state->gameOver;
+    }
+    
+    bool isOver() const { return state->gameOver; }
+    
+    // Cheap branch of the session: the world is shared for good, the state
+    // until one of the two sessions changes it.
+    AdventureGame fork() const { return *this; }
+    
+    // Snapshot layout (varints unless noted):
+    //   "ADV" version(u8) currentRoom moves gameOver(u8)
+    //   roomCount visitedBits[(roomCount + 7) / 8]
+    //   movedCount {item location+1}...   items resting outside their start room
+    //   inventoryCount {item}...           in pickup order
+    //   flagCount flagBits[(flagCount + 7) / 8]        (version 2 on)
+    //   checksum(u32 LE, FNV-1a of all preceding bytes)
+    std::vector<std::uint8_t> saveSnapshot() const {
+        const State& st = *state;
+        std::vector<std::uint8_t> out = {'A', 'D', 'V', SNAPSHOT_VERSION};
+        putVarint(out, st.currentRoom);
+        putVarint(out, st.moves);
+        out.push_back(st.gameOver ? 1 : 0);
+        
+        putBits(out, st.visited);
+        
+        std::vector<int> location(world->itemNames.size(), NOWHERE);
+        for (size_t r = 0; r < st.roomItems.size(); ++r) {
+            for (int item : st.roomItems[r]) location[item] = static_cast<int>(r);
+        }
+        std::vector<std::pair<int, int>> moved;
+        for (size_t item = 0; item < location.size(); ++item) {
+            bool carried = std::find(st.inventory.begin(), st.inventory.end(),
+                                     static_cast<int>(item)) != st.inventory.end();
+            if (!carried && location[item] != initialLocation(static_cast<int>(item))) {
+                moved.push_back({static_cast<int>(item), location[item]});
+            }
+        }
+        putVarint(out, static_cast<std::uint32_t>(moved.size()));
+        for (const auto& m : moved) {
+            putVarint(out, m.first);
+            putVarint(out, static_cast<std::uint32_t>(m.second + 1));
+        }
+        
+        putVarint(out, static_cast<std::uint32_t>(st.inventory.size()));
+        for (int item : st.inventory) putVarint(out, item);
+        putBits(out, st.flags);
+        
+        std::uint32_t sum = checksum(out.data(), out.size());
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<std::uint8_t>(sum >> (8 * i)));
+        return out;
+    }
+    
+    // Restores a snapshot taken from this world. Leaves the session untouched
+    // and returns false if the data is truncated, corrupt or from another world.
+    bool loadSnapshot(const std::vector<std::uint8_t>& data) {
+        if (data.size() < 8 || data[0] != 'A' || data[1] != 'D' || data[2] != 'V' ||
+            data[3] < 1 || data[3] > SNAPSHOT_VERSION) return false;
+        const std::uint8_t version = data[3];
+        size_t end = data.size() - 4;
+        std::uint32_t stored = 0;
+        for (int i = 0; i < 4; ++i) stored |= static_cast<std::uint32_t>(data[end + i]) << (8 * i);
+        if (stored != checksum(data.data(), end)) return false;
+        
+        const size_t roomCount = world->rooms.size();
+        const size_t itemCount = world->itemNames.size();
+        State st = initialState();
+        size_t pos = 4;
+        std::uint32_t v;
+        
+        if (!getVarint(data, pos, v) || v >= roomCount) return false;
+        st.currentRoom = static_cast<int>(v);
+        if (!getVarint(data, pos, v)) return false;
+        st.moves = static_cast<int>(v);
+        if (pos >= end) return false;
+        st.gameOver = data[pos++] != 0;
+        
+        if (!getBits(data, pos, end, st.visited)) return false;
+        
+        // Each item may be listed once, moved or carried, never both
+        std::vector<bool> listed(itemCount, false);
+        auto unplace = [&](int item) {
+            if (listed[item]) return false;
+            listed[item] = true;
+            int from = initialLocation(item);
+            if (from == NOWHERE) return true;
+            auto& items = st.roomItems[from];
+            items.erase(std::remove(items.begin(), items.end(), item), items.end());
+            return true;
+        };
+        
+        std::uint32_t movedCount;
+        if (!getVarint(data, pos, movedCount) || movedCount > itemCount) return false;
+        for (std::uint32_t i = 0; i < movedCount; ++i) {
+            std::uint32_t item, where;
+            if (!getVarint(data, pos, item) || item >= itemCount) return false;
+            if (!getVarint(data, pos, where) || where > roomCount) return false;
+            if (!unplace(static_cast<int>(item))) return false;
+            if (where > 0) st.roomItems[where - 1].push_back(static_cast<int>(item));
+        }
         
+        std::uint32_t carried;
+        if (!getVarint(data, pos, carried) || carried > itemCount) return false;
+        for (std::uint32_t i = 0; i < carried; ++i) {
+            std::uint32_t item;
+            if (!getVarint(data, pos, item) || item >= itemCount) return false;
+            if (!unplace(static_cast<int>(item))) return false;
+            st.inventory.push_back(static_cast<int>(item));
+        }
+        if (version >= 2 && !getBits(data, pos, end, st.flags)) return false; // version 1: no flags set
+        if (pos != end) return false;
+        
+        state = std::make_shared<State>(std::move(st));
+        return true;
+    }
+    
+    void play() {
+        initializeWorld();
+        static constexpr std::string_view BANNER =
+            "╔══════════════════════════════════════╗\n"
+            "║     THE CRYSTAL CAVE ADVENTURE       ║\n"
+            "╚══════════════════════════════════════╝\n"
+            "Find the treasure hidden in the cave!\n"
+            "Type 'help' for commands.\n";
+        OutputBuffer& out = screen();
+        out << BANNER;
         displayRoom();
         
-        while (!gameOver) {
-            std::cout << "\n> ";
+        // Commands only append to the screen; each turn goes out in one
+        // flush, with the prompt, before the next read
+        while (!state->gameOver) {
+            out << "\n> ";
+            out.flush();
             std::string input;
-            std::getline(std::cin, input);
+            if (!std::getline(std::cin, input)) break;
             parseCommand(input);
         }
+        out.flush();
     }
 };
-
@@ -8,10 +8,334 @@
 #include <vector>
 #include <algorithm>
 #include <limits>
+#include <string_view>
+#include <string>
+#include <array>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include "../common/output_buffer.h"
+#include "../common/mem_stats.h"
+
+// ============================================================
+// MONTE CARLO TREE SEARCH PLAYER
+// UCT with random playouts, for boards too big for minimax
+// ============================================================
+
+// n x n board, k in a row wins. Cells: 0 empty, 1 and 2 the two players.
+struct CompactBoard {
+    static constexpr int MAX_SIZE = 10;
+    
+    int size = 3;
+    int winLength = 3;
+    int filled = 0;
+    std::array<std::uint8_t, MAX_SIZE * MAX_SIZE> cells{};
+    
+    int cellCount() const { return size * size; }
+    
+    // Does the stone just placed at `idx` complete a line?
+    bool wins(int idx) const {
+        const int r = idx / size, c = idx % size;
+        const std::uint8_t p = cells[idx];
+        static const int DIRS[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+        for (const auto& d : DIRS) {
+            int run = 1;
+            for (int sign = -1; sign <= 1; sign += 2) {
+                int rr = r + sign * d[0], cc = c + sign * d[1];
+                while (rr >= 0 && rr < size && cc >= 0 && cc < size && cells[rr * size + cc] == p) {
+                    if (++run >= winLength) return true;
+                    rr += sign * d[0];
+                    cc += sign * d[1];
+                }
+            }
+        }
+        return false;
+    }
+    
+    // Plays `idx` for `player`; returns the winner (player), 3 for a draw or 0
+    int play(int idx, std::uint8_t player) {
+        cells[idx] = player;
+        filled++;
+        if (wins(idx)) return player;
+        return filled == cellCount() ? 3 : 0;
+    }
+};
+
+class MctsPlayer {
+public:
+    struct Config {
+        int timeBudgetMs = 1000;     // stop after this long...
+        long playoutBudget = 0;      // ...or after this many playouts (0 = no limit)
+        unsigned threads = std::thread::hardware_concurrency();
+        double exploration = 1.41;
+        int virtualLoss = 3;         // pending visits counted as losses while a playout runs (>= 1)
+        size_t maxNodes = 400000;    // the tree stops growing here; a 10x10 node is ~300 bytes
+    };
+    
+private:
+    struct Node {
+        int parent;
+        std::int16_t move;          // cell played to reach this node
+        std::uint8_t mover;         // player who made that move
+        std::uint8_t result;        // game result after the move (0 = still running)
+        std::vector<int> children;
+        std::vector<std::int16_t> untried;
+        double wins = 0;            // from the mover's point of view
+        int visits = 0;
+    };
+    
+    Config config;
+    std::deque<Node> nodes;         // deque: references stay valid as the tree grows
+    int root = -1;
+    CompactBoard rootBoard;
+    std::uint8_t rootToMove = 1;
+    std::mutex treeLock;
+    long lastPlayouts = 0;
+    
+    int newNode(int parent, int move, std::uint8_t mover, std::uint8_t result, const CompactBoard& b) {
+        Node n;
+        n.parent = parent;
+        n.move = static_cast<std::int16_t>(move);
+        n.mover = mover;
+        n.result = result;
+        if (result == 0) {
+            for (int i = 0; i < b.cellCount(); ++i) {
+                if (b.cells[i] == 0) n.untried.push_back(static_cast<std::int16_t>(i));
+            }
+        }
+        nodes.push_back(std::move(n));
+        return static_cast<int>(nodes.size()) - 1;
+    }
+    
+    void resetTree(const CompactBoard& board, std::uint8_t toMove) {
+        nodes.clear();
+        rootBoard = board;
+        rootToMove = toMove;
+        root = newNode(-1, -1, static_cast<std::uint8_t>(3 - toMove), 0, board);
+    }
+    
+    // Under treeLock: walks down by UCT, expands one child and applies
+    // virtual loss along the path. Leaves the leaf's position in `board`.
+    // At maxNodes nothing is expanded: the playout starts from the leaf.
+    int selectAndExpand(CompactBoard& board, std::uint64_t& rng) {
+        int cur = root;
+        while (true) {
+            Node& n = nodes[cur];
+            n.visits += config.virtualLoss;
+            if (n.result != 0) return cur;
+            if (!n.untried.empty()) {
+                if (nodes.size() >= config.maxNodes) return cur;
+                size_t pick = static_cast<size_t>(nextRandom(rng) % n.untried.size());
+                int move = n.untried[pick];
+                n.untried[pick] = n.untried.back();
+                n.untried.pop_back();
+                if (n.untried.empty()) n.untried.shrink_to_fit();
+                std::uint8_t mover = static_cast<std::uint8_t>(3 - n.mover);
+                std::uint8_t result = static_cast<std::uint8_t>(board.play(move, mover));
+                int child = newNode(cur, move, mover, result, board);
+                nodes[cur].children.push_back(child);
+                nodes[child].visits += config.virtualLoss;
+                return child;
+            }
+            
+            const double logParent = std::log(static_cast<double>(std::max(n.visits, 1)));
+            int best = -1;
+            double bestScore = -1;
+            for (int c : n.children) {
+                const Node& ch = nodes[c];
+                double score = ch.wins / ch.visits + config.exploration * std::sqrt(logParent / ch.visits);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = c;
+                }
+            }
+            board.play(nodes[best].move, nodes[best].mover);
+            cur = best;
+        }
+    }
+    
+    // Random moves to the end; returns the result (1, 2 or 3 = draw)
+    static int playout(CompactBoard& board, std::uint8_t toMove, std::uint64_t& rng) {
+        std::int16_t empty[CompactBoard::MAX_SIZE * CompactBoard::MAX_SIZE];
+        int count = 0;
+        for (int i = 0; i < board.cellCount(); ++i) {
+            if (board.cells[i] == 0) empty[count++] = static_cast<std::int16_t>(i);
+        }
+        while (count > 0) {
+            int pick = static_cast<int>(nextRandom(rng) % count);
+            int move = empty[pick];
+            empty[pick] = empty[--count];
+            int result = board.play(move, toMove);
+            if (result != 0) return result;
+            toMove = static_cast<std::uint8_t>(3 - toMove);
+        }
+        return 3;
+    }
+    
+    // Under treeLock: removes the virtual loss and records the real outcome
+    void backpropagate(int leaf, int result) {
+        for (int cur = leaf; cur != -1; cur = nodes[cur].parent) {
+            Node& n = nodes[cur];
+            n.visits += 1 - config.virtualLoss;
+            if (result == 3) n.wins += 0.5;
+            else if (result == n.mover) n.wins += 1;
+        }
+    }
+    
+    static std::uint64_t nextRandom(std::uint64_t& state) { // splitmix64
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    
+    // Moves the subtree under `keep` into a fresh store, breadth first, so
+    // the rest of the old tree is freed. `keep` becomes node 0, the root.
+    void compactTree(int keep) {
+        std::deque<Node> kept;
+        kept.push_back(std::move(nodes[keep]));
+        kept[0].parent = -1;
+        for (size_t i = 0; i < kept.size(); ++i) {
+            for (int& c : kept[i].children) {
+                Node& child = nodes[c];
+                child.parent = static_cast<int>(i);
+                c = static_cast<int>(kept.size());
+                kept.push_back(std::move(child));
+            }
+        }
+        nodes.swap(kept);
+        root = 0;
+    }
+    
+    void worker(std::chrono::steady_clock::time_point deadline, std::atomic<long>& started,
+                std::atomic<long>& finished, std::uint64_t seed) {
+        std::uint64_t rng = seed;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (config.playoutBudget > 0 && started.fetch_add(1) >= config.playoutBudget) break;
+            
+            CompactBoard board = rootBoard;
+            int leaf, result;
+            std::uint8_t toMove;
+            {
+                std::lock_guard<std::mutex> lock(treeLock);
+                leaf = selectAndExpand(board, rng);
+                result = nodes[leaf].result;
+                toMove = static_cast<std::uint8_t>(3 - nodes[leaf].mover);
+            }
+            // The expensive part runs unlocked on the thread's own board copy
+            if (result == 0) result = playout(board, toMove, rng);
+            {
+                std::lock_guard<std::mutex> lock(treeLock);
+                backpropagate(leaf, result);
+            }
+            finished++;
+        }
+    }
+    
+public:
+    MctsPlayer() : MctsPlayer(Config()) {}
+    
+    // Invalid settings fall back to the defaults
+    explicit MctsPlayer(Config config) {
+        if (!configure(config)) configure(Config());
+    }
+    
+    // New settings also drop the search tree. Returns false and keeps the
+    // current settings if virtualLoss < 1 (UCT would divide by a pending
+    // child's zero visits) or maxNodes < 1.
+    bool configure(const Config& settings) {
+        if (settings.virtualLoss < 1 || settings.maxNodes < 1) return false;
+        config = settings;
+        if (config.threads == 0) config.threads = 1;
+        nodes.clear();
+        root = -1;
+        return true;
+    }
+    
+    // Keeps the subtree below `move` when the board is the root board plus
+    // that move; otherwise the search starts over from `board`. The rest of
+    // the tree is freed; a subtree already at maxNodes is dropped too.
+    void observe(const CompactBoard& board, int move, std::uint8_t toMove) {
+        int keep = -1;
+        CompactBoard expected;
+        if (root >= 0) {
+            for (int c : nodes[root].children) {
+                if (nodes[c].move != move) continue;
+                expected = rootBoard;
+                expected.play(move, nodes[c].mover);
+                if (expected.cells == board.cells && 3 - nodes[c].mover == toMove) keep = c;
+                break;
+            }
+        }
+        if (keep >= 0) {
+            compactTree(keep);
+            if (nodes.size() < config.maxNodes) {
+                rootBoard = expected;
+                rootToMove = toMove;
+                return;
+            }
+        }
+        resetTree(board, toMove);
+    }
+    
+    // Searches from `board` with `toMove` to play and returns the chosen cell
+    int chooseMove(const CompactBoard& board, std::uint8_t toMove) {
+        if (root < 0 || rootBoard.cells != board.cells || rootToMove != toMove ||
+            rootBoard.size != board.size || rootBoard.winLength != board.winLength) {
+            resetTree(board, toMove);
+        }
+        
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.timeBudgetMs);
+        std::atomic<long> started{0};
+        std::atomic<long> finished{0};
+        std::vector<std::thread> pool;
+        std::uint64_t seed = static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+        for (unsigned t = 0; t < config.threads; ++t) {
+            pool.emplace_back(&MctsPlayer::worker, this, deadline, std::ref(started), std::ref(finished),
+                              seed + 0x51ED * t);
+        }
+        for (auto& th : pool) th.join();
+        lastPlayouts = finished;
+        
+        // Most visited child: the robust choice
+        int best = -1;
+        for (int c : nodes[root].children) {
+            if (best < 0 || nodes[c].visits > nodes[best].visits) best = c;
+        }
+        if (best < 0) { // no playout finished in time: take any legal move
+            for (int i = 0; i < board.cellCount(); ++i) {
+                if (board.cells[i] == 0) return i;
+            }
+        }
+        return nodes[best].move;
+    }
+    
+    long playoutsLastMove() const { return lastPlayouts; }
+};
 
 class TicTacToe {
 private:
-    std::vector<std::vector<char>> board;
+    // Tag for --mem-stats: the board's rows and cells
+    struct BoardMemory {
+        static constexpr const char* name = "TicTacToe::board";
+    };
+    using Row = std::vector<char, TrackingAllocator<char, BoardMemory>>;
+    
+    std::vector<Row, TrackingAllocator<Row, BoardMemory>> board;
+    int size = 3;
+    int winLength = 3;
+    bool useMcts = false;     // otherwise exhaustive minimax (3x3 only)
+    MctsPlayer mcts;
+    int frameSize = 0;        // board frame, rebuilt when the size changes
+    std::string columnHeader;
+    std::string frameTop;
+    std::string frameDivider;
+    std::string frameBottom;
     char currentPlayer;
     char playerSymbol;
     char aiSymbol;
@@ -20,35 +344,66 @@ private:
     int draws;
     
     void initializeBoard() {
-        board = std::vector<std::vector<char>>(3, std::vector<char>(3, ' '));
+        board.assign(size, Row(size, ' '));
+        if (frameSize != size) buildFrame();
+    }
+    
+    void buildFrame() {
+        auto line = [this](std::string_view left, std::string_view mid, std::string_view right) {
+            std::string s = "  ";
+            s += left;
+            for (int j = 0; j < size; ++j) {
+                s += "═══";
+                s += (j + 1 < size) ? mid : right;
+            }
+            return s + "\n";
+        };
+        frameSize = size;
+        columnHeader = "\n   ";
+        for (int j = 0; j < size; ++j) {
+            columnHeader += " " + std::to_string(j) + (j + 1 < size ? "  " : "\n");
+        }
+        frameTop = line("╔", "╦", "╗");
+        frameDivider = line("╠", "╬", "╣");
+        frameBottom = line("╚", "╩", "╝");
     }
     
     void displayBoard() {
-        std::cout << "\n    0   1   2\n";
-        std::cout << "  ╔═══╦═══╦═══╗\n";
-        for (int i = 0; i < 3; ++i) {
-            std::cout << i << " ║ ";
-            for (int j = 0; j < 3; ++j) {
-                std::cout << board[i][j] << " ║ ";
+        OutputBuffer& out = screen();
+        out << columnHeader << frameTop;
+        for (int i = 0; i < size; ++i) {
+            out << i << " ║ ";
+            for (int j = 0; j < size; ++j) {
+                out << board[i][j] << " ║ ";
             }
-            std::cout << "\n";
-            if (i < 2) std::cout << "  ╠═══╬═══╬═══╣\n";
+            out << "\n";
+            if (i < size - 1) out << frameDivider;
         }
-        std::cout << "  ╚═══╩═══╩═══╝\n";
+        out << frameBottom;
+        out.flush();
     }
     
     bool isValidMove(int row, int col) {
-        return row >= 0 && row < 3 && col >= 0 && col < 3 && board[row][col] == ' ';
+        return row >= 0 && row < size && col >= 0 && col < size && board[row][col] == ' ';
     }
     
     bool checkWin(char player) {
-        // Check rows, columns, and diagonals
-        for (int i = 0; i < 3; ++i) {
-            if (board[i][0] == player && board[i][1] == player && board[i][2] == player) return true;
-            if (board[0][i] == player && board[1][i] == player && board[2][i] == player) return true;
+        // Check rows, columns, and diagonals for winLength in a row
+        static const int DIRS[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+        for (int i = 0; i < size; ++i) {
+            for (int j = 0; j < size; ++j) {
+                for (const auto& d : DIRS) {
+                    int k = 0;
+                    int r = i, c = j;
+                    while (k < winLength && r >= 0 && r < size && c >= 0 && c < size && board[r][c] == player) {
+                        ++k;
+                        r += d[0];
+                        c += d[1];
+                    }
+                    if (k == winLength) return true;
+                }
+            }
         }
-        if (board[0][0] == player && board[1][1] == player && board[2][2] == player) return true;
-        if (board[0][2] == player && board[1][1] == player && board[2][0] == player) return true;
         return false;
     }
     
@@ -66,8 +421,8 @@ private:
         
         if (isMaximizing) {
             int maxEval = -1000;
-            for (int i = 0; i < 3; ++i) {
-                for (int j = 0; j < 3; ++j) {
+            for (int i = 0; i < size; ++i) {
+                for (int j = 0; j < size; ++j) {
                     if (board[i][j] == ' ') {
                         board[i][j] = aiSymbol;
                         int eval = minimax(depth + 1, false, alpha, beta);
@@ -81,8 +436,8 @@ private:
             return maxEval;
         } else {
             int minEval = 1000;
-            for (int i = 0; i < 3; ++i) {
-                for (int j = 0; j < 3; ++j) {
+            for (int i = 0; i < size; ++i) {
+                for (int j = 0; j < size; ++j) {
                     if (board[i][j] == ' ') {
                         board[i][j] = playerSymbol;
                         int eval = minimax(depth + 1, true, alpha, beta);
@@ -97,12 +452,45 @@ private:
         }
     }
     
+    static std::uint8_t stoneOf(char symbol) {
+        return symbol == 'X' ? 1 : 2;
+    }
+    
+    CompactBoard compactBoard() const {
+        CompactBoard b;
+        b.size = size;
+        b.winLength = winLength;
+        for (int i = 0; i < size; ++i) {
+            for (int j = 0; j < size; ++j) {
+                if (board[i][j] == ' ') continue;
+                b.cells[i * size + j] = stoneOf(board[i][j]);
+                b.filled++;
+            }
+        }
+        return b;
+    }
+    
+    void mctsMove() {
+        int move = mcts.chooseMove(compactBoard(), stoneOf(aiSymbol));
+        int row = move / size, col = move % size;
+        board[row][col] = aiSymbol;
+        mcts.observe(compactBoard(), move, stoneOf(playerSymbol));
+        std::cout << "AI plays at (" << row << ", " << col << ") after "
+                  << mcts.playoutsLastMove() << " playouts\n";
+    }
+    
     void aiMove() {
+        MEM_SCOPE("TicTacToe::aiMove");
+        if (useMcts) {
+            mctsMove();
+            return;
+        }
+        
         int bestVal = -1000;
         int bestRow = -1, bestCol = -1;
         
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < size; ++i) {
+            for (int j = 0; j < size; ++j) {
                 if (board[i][j] == ' ') {
                     board[i][j] = aiSymbol;
                     int moveVal = minimax(0, false, -1000, 1000);
@@ -121,6 +509,35 @@ private:
         std::cout << "AI plays at (" << bestRow << ", " << bestCol << ")\n";
     }
     
+    int readInt(const char* prompt, int lo, int hi, int fallback) {
+        std::cout << prompt;
+        int value;
+        if (!(std::cin >> value)) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            return fallback;
+        }
+        return std::min(std::max(value, lo), hi);
+    }
+    
+    void chooseEngine() {
+        std::cout << "\nAI engine:\n";
+        std::cout << "1. Minimax (3x3, perfect play)\n";
+        std::cout << "2. Monte Carlo tree search (boards up to 10x10)\n";
+        int choice = readInt("Choice: ", 1, 2, 1);
+        
+        useMcts = choice == 2;
+        if (!useMcts) {
+            size = winLength = 3;
+            return;
+        }
+        size = readInt("Board size (3-10): ", 3, CompactBoard::MAX_SIZE, 3);
+        winLength = readInt("Marks in a row to win: ", 3, size, std::min(size, 5));
+        MctsPlayer::Config config;
+        config.timeBudgetMs = readInt("AI thinking time per move (ms): ", 10, 60000, 1000);
+        mcts.configure(config);
+    }
+    
 public:
     TicTacToe() : playerScore(0), aiScore(0), draws(0) {
         initializeBoard();
@@ -131,6 +548,7 @@ public:
         std::cin >> playerSymbol;
         playerSymbol = toupper(playerSymbol);
         aiSymbol = (playerSymbol == 'X') ? 'O' : 'X';
+        chooseEngine();
         
         char playAgain;
         do {
@@ -142,7 +560,7 @@ public:
                 
                 if (currentPlayer == playerSymbol) {
                     int row, col;
-                    std::cout << "Your turn! Enter row (0-2) and column (0-2): ";
+                    std::cout << "Your turn! Enter row (0-" << size - 1 << ") and column (0-" << size - 1 << "): ";
                     if (!(std::cin >> row >> col)) {
                         std::cin.clear();
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -156,6 +574,7 @@ public:
                     }
                     
                     board[row][col] = playerSymbol;
+                    if (useMcts) mcts.observe(compactBoard(), row * size + col, stoneOf(aiSymbol));
                 } else {
                     std::cout << "AI is thinking...\n";
                     aiMove();
@@ -0,0 +1,114 @@
+// ============================================================
+// SHARED BLOCK COMPRESSOR
+// A small LZ77 codec in the style of LZ4: greedy hash matching,
+// byte-aligned tokens, no entropy stage
+// ============================================================
+
+#ifndef CPP_PROJECTS_LZ_BLOCK_H
+#define CPP_PROJECTS_LZ_BLOCK_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+// Compressed stream: a run of sequences, each
+//   token   high nibble = literal count, low nibble = match length - 4
+//           (15 in either means extra length bytes follow, 255 = keep going)
+//   literals, u16 little-endian match offset, extra match length bytes
+// The final sequence has literals only and ends the stream.
+class LzBlock {
+private:
+    static constexpr int HASH_BITS = 14;
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t MAX_OFFSET = 65535;
+    static constexpr std::uint32_t NO_POSITION = 0xFFFFFFFF;
+    
+    static void putLength(std::string& out, size_t value) {
+        for (; value >= 255; value -= 255) out.push_back(static_cast<char>(255));
+        out.push_back(static_cast<char>(value));
+    }
+    
+    static bool readLength(const unsigned char*& ip, const unsigned char* end, size_t& value, size_t limit) {
+        unsigned char byte;
+        do {
+            if (ip == end || value > limit) return false;
+            byte = *ip++;
+            value += byte;
+        } while (byte == 255);
+        return true;
+    }
+    
+    static void emit(std::string& out, const char* literals, size_t literalCount, size_t offset, size_t matchLength) {
+        size_t matchCode = matchLength - MIN_MATCH;
+        out.push_back(static_cast<char>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+        if (literalCount >= 15) putLength(out, literalCount - 15);
+        out.append(literals, literalCount);
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (matchCode >= 15) putLength(out, matchCode - 15);
+    }
+    
+public:
+    // Appends the compressed form of src[0, size) to out
+    static void compress(const char* src, size_t size, std::string& out) {
+        std::vector<std::uint32_t> table(size_t(1) << HASH_BITS, NO_POSITION);
+        size_t anchor = 0;
+        size_t i = 0;
+        while (i + MIN_MATCH <= size) {
+            std::uint32_t word;
+            std::memcpy(&word, src + i, sizeof(word));
+            std::uint32_t h = (word * 2654435761u) >> (32 - HASH_BITS);
+            std::uint32_t candidate = table[h];
+            table[h] = static_cast<std::uint32_t>(i);
+            if (candidate == NO_POSITION || i - candidate > MAX_OFFSET ||
+                std::memcmp(src + candidate, src + i, MIN_MATCH) != 0) {
+                ++i;
+                continue;
+            }
+            size_t length = MIN_MATCH;
+            while (i + length < size && src[candidate + length] == src[i + length]) ++length;
+            emit(out, src + anchor, i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+        }
+        
+        size_t rest = size - anchor;
+        out.push_back(static_cast<char>(std::min<size_t>(rest, 15) << 4));
+        if (rest >= 15) putLength(out, rest - 15);
+        out.append(src + anchor, rest);
+    }
+    
+    // Expands src into exactly rawSize bytes at dst. Returns false on any
+    // malformed input instead of reading or writing out of bounds.
+    static bool decompress(const char* src, size_t size, char* dst, size_t rawSize) {
+        const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+        const unsigned char* end = ip + size;
+        size_t op = 0;
+        while (ip < end) {
+            unsigned char token = *ip++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !readLength(ip, end, literals, rawSize)) return false;
+            if (literals > static_cast<size_t>(end - ip) || literals > rawSize - op) return false;
+            std::memcpy(dst + op, ip, literals);
+            ip += literals;
+            op += literals;
+            if (ip == end) break;
+            
+            if (end - ip < 2) return false;
+            size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+            ip += 2;
+            size_t length = token & 15;
+            if (length == 15 && !readLength(ip, end, length, rawSize)) return false;
+            length += MIN_MATCH;
+            if (offset == 0 || offset > op || length > rawSize - op) return false;
+            // Byte by byte: a match may overlap the bytes it produces
+            for (size_t k = 0; k < length; ++k, ++op) dst[op] = dst[op - offset];
+        }
+        return op == rawSize;
+    }
+};
+
+#endif
@@ -0,0 +1,324 @@
+// ============================================================
+// SHARED MEMORY ACCOUNTING
+// Heap-wide and per-container byte counts, plus allocations per
+// operation. Build with -DCPP_PROJECTS_MEM_STATS=1 to enable;
+// otherwise the allocators are plain std::allocator and every
+// MEM_* macro expands to nothing.
+// ============================================================
+
+#ifndef CPP_PROJECTS_MEM_STATS_H
+#define CPP_PROJECTS_MEM_STATS_H
+
+#ifndef CPP_PROJECTS_MEM_STATS
+#define CPP_PROJECTS_MEM_STATS 0
+#endif
+
+#include <memory>
+
+#if CPP_PROJECTS_MEM_STATS
+
+#include <iostream>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Keeps the hook out of line: inlined into callers, the compiler pairs the
+// malloc/free inside it with the callers' new/delete and warns
+#if defined(_MSC_VER)
+#define MEM_STATS_NOINLINE __declspec(noinline)
+#else
+#define MEM_STATS_NOINLINE __attribute__((noinline))
+#endif
+
+// Live, peak and total byte counts for one heap or account
+struct MemCounters {
+    std::atomic<std::int64_t> live{0};
+    std::atomic<std::int64_t> peak{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> bytes{0}; // allocated over the whole run
+    
+    void add(std::size_t n) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(n, std::memory_order_relaxed);
+        std::int64_t now = live.fetch_add(static_cast<std::int64_t>(n), std::memory_order_relaxed) +
+                           static_cast<std::int64_t>(n);
+        raisePeak(now);
+    }
+    
+    void remove(std::size_t n) {
+        live.fetch_sub(static_cast<std::int64_t>(n), std::memory_order_relaxed);
+    }
+    
+    void raisePeak(std::int64_t value) {
+        std::int64_t seen = peak.load(std::memory_order_relaxed);
+        while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+};
+
+class MemStats {
+public:
+    using Counters = MemCounters;
+    
+    // The buffers of every container whose allocator carries one tag
+    struct Account {
+        const char* name;
+        Counters counters;
+    };
+    
+    class Scope;
+    
+private:
+    // Precedes every block from the hooked operator new; keeps the payload
+    // aligned for any type
+    struct alignas(alignof(std::max_align_t)) Header {
+        std::size_t size;
+    };
+    
+    // Precedes every over-aligned block; the payload is rounded up inside a
+    // larger malloc block, so the header also remembers where that starts
+    struct AlignedHeader {
+        void* block;
+        std::size_t size;
+    };
+    
+    struct Operation {
+        const char* name;
+        std::uint64_t count;
+        std::uint64_t allocations;
+        std::uint64_t bytes;
+        std::int64_t peak; // most live bytes above the start, any one call
+    };
+    
+    static inline Counters heap; // constant-initialised: usable before main
+    static inline std::mutex tableLock;
+    static inline std::vector<Account*> accounts;
+    static inline std::vector<Operation> operations;
+    static inline bool reportRequested = false;
+    
+    static void record(const char* name, std::uint64_t allocs, std::uint64_t bytes, std::int64_t peak) {
+        std::lock_guard<std::mutex> lock(tableLock);
+        for (Operation& op : operations) {
+            if (std::strcmp(op.name, name) == 0) {
+                op.count++;
+                op.allocations += allocs;
+                op.bytes += bytes;
+                if (peak > op.peak) op.peak = peak;
+                return;
+            }
+        }
+        operations.push_back({name, 1, allocs, bytes, peak});
+    }
+    
+public:
+    // ---- global hook, called by the replacement operator new/delete ----
+    
+    MEM_STATS_NOINLINE static void* allocate(std::size_t size) {
+        void* block = std::malloc(sizeof(Header) + size);
+        if (!block) return nullptr;
+        static_cast<Header*>(block)->size = size;
+        heap.add(size);
+        return static_cast<Header*>(block) + 1;
+    }
+    
+    MEM_STATS_NOINLINE static void release(void* p) {
+        if (!p) return;
+        Header* h = static_cast<Header*>(p) - 1;
+        heap.remove(h->size);
+        std::free(h);
+    }
+    
+    // For the std::align_val_t overloads; `align` is a power of two
+    MEM_STATS_NOINLINE static void* allocateAligned(std::size_t size, std::size_t align) {
+        if (align < alignof(AlignedHeader)) align = alignof(AlignedHeader);
+        std::size_t room = sizeof(AlignedHeader) + align - 1;
+        char* block = static_cast<char*>(std::malloc(room + size));
+        if (!block) return nullptr;
+        std::uintptr_t payload = (reinterpret_cast<std::uintptr_t>(block) + room) & ~(std::uintptr_t(align) - 1);
+        AlignedHeader* h = reinterpret_cast<AlignedHeader*>(payload) - 1;
+        h->block = block;
+        h->size = size;
+        heap.add(size);
+        return reinterpret_cast<void*>(payload);
+    }
+    
+    MEM_STATS_NOINLINE static void releaseAligned(void* p) {
+        if (!p) return;
+        AlignedHeader* h = static_cast<AlignedHeader*>(p) - 1;
+        heap.remove(h->size);
+        std::free(h->block);
+    }
+    
+    // ---- queries ----
+    
+    static std::int64_t liveBytes() { return heap.live.load(std::memory_order_relaxed); }
+    static std::int64_t peakBytes() { return heap.peak.load(std::memory_order_relaxed); }
+    static std::uint64_t allocations() { return heap.allocations.load(std::memory_order_relaxed); }
+    
+    // The account for containers tagged `Tag` (a type with a static `name`)
+    template <typename Tag>
+    static Account& account() {
+        static Account& a = *[] {
+            auto* fresh = new Account{Tag::name, {}};
+            std::lock_guard<std::mutex> lock(tableLock);
+            accounts.push_back(fresh);
+            return fresh;
+        }();
+        return a;
+    }
+    
+    // --mem-stats: print the report when the program ends
+    static void requestReport() { reportRequested = true; }
+    static bool reportWanted() { return reportRequested; }
+    
+    static void writeReport(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(tableLock);
+        char line[160];
+        os << "\n=== MEMORY (bytes) ===\n";
+        std::snprintf(line, sizeof(line), "%-28s %12s %12s %12s %14s\n", "heap / container", "live", "peak",
+                      "allocations", "allocated");
+        os << line;
+        auto row = [&](const char* name, const Counters& c) {
+            std::snprintf(line, sizeof(line), "%-28s %12lld %12lld %12llu %14llu\n", name,
+                          static_cast<long long>(c.live.load()), static_cast<long long>(c.peak.load()),
+                          static_cast<unsigned long long>(c.allocations.load()),
+                          static_cast<unsigned long long>(c.bytes.load()));
+            os << line;
+        };
+        row("(whole heap)", heap);
+        for (const Account* a : accounts) row(a->name, a->counters);
+        
+        if (operations.empty()) return;
+        std::snprintf(line, sizeof(line), "\n%-28s %8s %12s %14s %14s\n", "operation", "count", "allocs/call",
+                      "bytes/call", "peak above start");
+        os << line;
+        for (const Operation& op : operations) {
+            std::snprintf(line, sizeof(line), "%-28s %8llu %12.1f %14.1f %14lld\n", op.name,
+                          static_cast<unsigned long long>(op.count),
+                          static_cast<double>(op.allocations) / op.count, static_cast<double>(op.bytes) / op.count,
+                          static_cast<long long>(op.peak));
+            os << line;
+        }
+    }
+};
+
+// Counts the heap traffic of the enclosing block under `name`. Counts are
+// process-wide, so background threads working at the same time show up too.
+class MemStats::Scope {
+private:
+    const char* name;
+    std::uint64_t startAllocations;
+    std::uint64_t startBytes;
+    std::int64_t startLive;
+    std::int64_t outerPeak;
+    
+public:
+    explicit Scope(const char* name)
+        : name(name),
+          startAllocations(heap.allocations.load(std::memory_order_relaxed)),
+          startBytes(heap.bytes.load(std::memory_order_relaxed)),
+          startLive(heap.live.load(std::memory_order_relaxed)),
+          outerPeak(heap.peak.exchange(startLive, std::memory_order_relaxed)) {}
+          
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    
+    ~Scope() {
+        std::uint64_t allocs = heap.allocations.load(std::memory_order_relaxed) - startAllocations;
+        std::uint64_t bytes = heap.bytes.load(std::memory_order_relaxed) - startBytes;
+        std::int64_t peak = heap.peak.load(std::memory_order_relaxed) - startLive;
+        heap.raisePeak(outerPeak);
+        record(name, allocs, bytes, peak);
+    }
+};
+
+// Allocator that charges a container's own buffer to the account for Tag.
+// Heap blocks owned by the elements (strings, nested vectors with their own
+// allocator) are only in the whole-heap figures.
+template <typename T, typename Tag>
+class TrackingAllocator {
+public:
+    using value_type = T;
+    
+    TrackingAllocator() = default;
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U, Tag>&) {}
+    
+    T* allocate(std::size_t n) {
+        MemStats::account<Tag>().counters.add(n * sizeof(T));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    
+    void deallocate(T* p, std::size_t n) {
+        MemStats::account<Tag>().counters.remove(n * sizeof(T));
+        ::operator delete(p);
+    }
+    
+    template <typename U>
+    bool operator==(const TrackingAllocator<U, Tag>&) const { return true; }
+    template <typename U>
+    bool operator!=(const TrackingAllocator<U, Tag>&) const { return false; }
+};
+
+// Replaces the global operator new/delete, over-aligned forms included.
+// Expand exactly once per program, in the file that defines main.
+#define MEM_STATS_HOOK \
+    void* operator new(std::size_t n) { \
+        if (void* p = MemStats::allocate(n)) return p; \
+        throw std::bad_alloc(); \
+    } \
+    void* operator new[](std::size_t n) { return operator new(n); } \
+    void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return MemStats::allocate(n); } \
+    void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return MemStats::allocate(n); } \
+    void operator delete(void* p) noexcept { MemStats::release(p); } \
+    void operator delete[](void* p) noexcept { MemStats::release(p); } \
+    void operator delete(void* p, std::size_t) noexcept { MemStats::release(p); } \
+    void operator delete[](void* p, std::size_t) noexcept { MemStats::release(p); } \
+    void operator delete(void* p, const std::nothrow_t&) noexcept { MemStats::release(p); } \
+    void operator delete[](void* p, const std::nothrow_t&) noexcept { MemStats::release(p); } \
+    void* operator new(std::size_t n, std::align_val_t a) { \
+        if (void* p = MemStats::allocateAligned(n, static_cast<std::size_t>(a))) return p; \
+        throw std::bad_alloc(); \
+    } \
+    void* operator new[](std::size_t n, std::align_val_t a) { return operator new(n, a); } \
+    void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { \
+        return MemStats::allocateAligned(n, static_cast<std::size_t>(a)); \
+    } \
+    void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { \
+        return MemStats::allocateAligned(n, static_cast<std::size_t>(a)); \
+    } \
+    void operator delete(void* p, std::align_val_t) noexcept { MemStats::releaseAligned(p); } \
+    void operator delete[](void* p, std::align_val_t) noexcept { MemStats::releaseAligned(p); } \
+    void operator delete(void* p, std::size_t, std::align_val_t) noexcept { MemStats::releaseAligned(p); } \
+    void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { MemStats::releaseAligned(p); } \
+    void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { MemStats::releaseAligned(p); } \
+    void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { MemStats::releaseAligned(p); }
+    
+#define MEM_JOIN_(a, b) a##b
+#define MEM_JOIN(a, b) MEM_JOIN_(a, b)
+// Records the rest of the enclosing block as one call of operation `name`
+#define MEM_SCOPE(name) MemStats::Scope MEM_JOIN(memScope_, __LINE__)(name)
+// Turns on the report at exit; true if accounting is built in
+#define MEM_STATS_REQUEST_REPORT() (MemStats::requestReport(), true)
+#define MEM_STATS_REPORT() do { \
+        if (MemStats::reportWanted()) MemStats::writeReport(std::cout); \
+    } while (0)
+    
+#else
+
+template <typename T, typename Tag>
+using TrackingAllocator = std::allocator<T>;
+
+#define MEM_STATS_HOOK
+#define MEM_SCOPE(name) ((void)0)
+#define MEM_STATS_REQUEST_REPORT() false
+#define MEM_STATS_REPORT() ((void)0)
+
+#endif
+
+#endif
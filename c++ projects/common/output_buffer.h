@@ -0,0 +1,108 @@
+// ============================================================
+// SHARED CONSOLE OUTPUT BUFFER
+// Builds a whole screen in memory and writes it with one flush
+// ============================================================
+
+#ifndef CPP_PROJECTS_OUTPUT_BUFFER_H
+#define CPP_PROJECTS_OUTPUT_BUFFER_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
+#include <cstddef>
+
+// A double printed in fixed notation, like `std::fixed << std::setprecision(p)`
+struct Fixed {
+    double value;
+    int precision;
+};
+
+class OutputBuffer {
+private:
+    static constexpr size_t FLUSH_THRESHOLD = 1 << 16; // long listings go out in 64 KiB chunks
+    
+    std::string buf;
+    
+    template <typename... Args>
+    void appendChars(Args... args) {
+        char tmp[64];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), args...);
+        buf.append(tmp, res.ptr);
+    }
+    
+public:
+    OutputBuffer() {
+        buf.reserve(2 * FLUSH_THRESHOLD);
+    }
+    
+    OutputBuffer& operator<<(std::string_view s) { buf.append(s); return *this; }
+    OutputBuffer& operator<<(const char* s) { buf.append(s); return *this; }
+    OutputBuffer& operator<<(const std::string& s) { buf.append(s); return *this; }
+    OutputBuffer& operator<<(char c) { buf.push_back(c); return *this; }
+    
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    OutputBuffer& operator<<(T value) {
+        appendChars(value);
+        return *this;
+    }
+    
+    // Same shape as the default iostream float format (%g, 6 significant digits)
+    OutputBuffer& operator<<(double value) {
+        appendChars(value, std::chars_format::general, 6);
+        return *this;
+    }
+    
+    OutputBuffer& operator<<(Fixed f) {
+        appendChars(f.value, std::chars_format::fixed, f.precision);
+        return *this;
+    }
+    
+    OutputBuffer& repeat(std::string_view s, size_t count) {
+        for (size_t i = 0; i < count; ++i) buf.append(s);
+        return *this;
+    }
+    
+    // `std::setw(width) << std::left << value`: pads with spaces, never truncates
+    template <typename T>
+    OutputBuffer& left(const T& value, size_t width) {
+        size_t start = buf.size();
+        *this << value;
+        size_t written = buf.size() - start;
+        if (written < width) buf.append(width - written, ' ');
+        return *this;
+    }
+    
+    // `std::setw(width) << value` with the default right alignment
+    template <typename T>
+    OutputBuffer& right(const T& value, size_t width) {
+        size_t start = buf.size();
+        *this << value;
+        size_t written = buf.size() - start;
+        if (written < width) buf.insert(start, width - written, ' ');
+        return *this;
+    }
+    
+    size_t size() const { return buf.size(); }
+    
+    // Called inside long loops so memory stays bounded
+    void flushIfFull() {
+        if (buf.size() >= FLUSH_THRESHOLD) flush();
+    }
+    
+    void flush() {
+        if (!buf.empty()) std::cout.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        std::cout.flush();
+        buf.clear();
+    }
+};
+
+// Process-wide buffer reused by every screen. Anything appended must be
+// flushed before the caller next writes to std::cout or reads std::cin.
+inline OutputBuffer& screen() {
+    static OutputBuffer out;
+    return out;
+}
+
+#endif
@@ -0,0 +1,297 @@
+// ============================================================
+// SHARED OPERATION TRACING
+// Scoped timers, per-thread latency histograms and I/O counters.
+// Build with -DCPP_PROJECTS_TRACING=1 to enable; otherwise every
+// TRACE_* macro expands to nothing.
+// ============================================================
+
+#ifndef CPP_PROJECTS_TRACING_H
+#define CPP_PROJECTS_TRACING_H
+
+#ifndef CPP_PROJECTS_TRACING
+#define CPP_PROJECTS_TRACING 0
+#endif
+
+#if CPP_PROJECTS_TRACING
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+// Log-linear buckets in the style of HdrHistogram: values below 16 are
+// exact, above that each power of two is split into 16 linear steps, so
+// any reading is within ~6% of the true value.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int BUCKETS = SUB_COUNT + (64 - SUB_BITS) * SUB_COUNT;
+    
+    std::uint64_t counts[BUCKETS] = {};
+    std::uint64_t total = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t largest = 0;
+    
+    static int bucketOf(std::uint64_t v) {
+        if (v < SUB_COUNT) return static_cast<int>(v);
+        int exponent = 0; // index of the highest set bit
+        for (int shift = 32; shift > 0; shift >>= 1) {
+            if (v >> (exponent + shift)) exponent += shift;
+        }
+        int sub = static_cast<int>((v >> (exponent - SUB_BITS)) & (SUB_COUNT - 1));
+        return SUB_COUNT + (exponent - SUB_BITS) * SUB_COUNT + sub;
+    }
+    
+    // Midpoint of the values that land in bucket b
+    static std::uint64_t valueOf(int b) {
+        if (b < SUB_COUNT) return static_cast<std::uint64_t>(b);
+        int exponent = (b - SUB_COUNT) / SUB_COUNT + SUB_BITS;
+        std::uint64_t sub = static_cast<std::uint64_t>((b - SUB_COUNT) % SUB_COUNT);
+        std::uint64_t step = std::uint64_t(1) << (exponent - SUB_BITS);
+        return (SUB_COUNT + sub) * step + step / 2;
+    }
+    
+public:
+    void record(std::uint64_t v) {
+        counts[bucketOf(v)]++;
+        total++;
+        sum += v;
+        if (v > largest) largest = v;
+    }
+    
+    void merge(const LatencyHistogram& o) {
+        for (int b = 0; b < BUCKETS; ++b) counts[b] += o.counts[b];
+        total += o.total;
+        sum += o.sum;
+        if (o.largest > largest) largest = o.largest;
+    }
+    
+    // Value at quantile q (0..1)
+    std::uint64_t quantile(double q) const {
+        if (total == 0) return 0;
+        std::uint64_t rank = static_cast<std::uint64_t>(q * (total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= rank) return std::min(valueOf(b), largest);
+        }
+        return largest;
+    }
+    
+    std::uint64_t count() const { return total; }
+    std::uint64_t totalValue() const { return sum; }
+    std::uint64_t max() const { return largest; }
+};
+
+class Tracer {
+public:
+    struct Event {
+        const char* name;
+        std::uint64_t startNs;
+        std::uint64_t durationNs;
+        std::uint64_t bytesRead;
+        std::uint64_t bytesWritten;
+        std::uint64_t records;
+    };
+    
+    // Everything one thread records; only that thread writes to it
+    struct ThreadLog {
+        int tid;
+        std::vector<Event> events;
+        std::uint64_t droppedEvents = 0;
+        std::uint64_t bytesRead = 0;
+        std::uint64_t bytesWritten = 0;
+        std::uint64_t records = 0;
+        std::vector<std::pair<const char*, LatencyHistogram>> histograms;
+        
+        LatencyHistogram& histogram(const char* name) {
+            for (auto& h : histograms) {
+                if (h.first == name) return h.second;
+            }
+            histograms.emplace_back(name, LatencyHistogram());
+            return histograms.back().second;
+        }
+    };
+    
+    class Scope;
+    
+private:
+    static constexpr size_t MAX_EVENTS_PER_THREAD = 1 << 20; // histograms keep counting past this
+    
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::mutex logsLock;
+    std::vector<std::unique_ptr<ThreadLog>> logs;
+    
+    static std::string microseconds(std::uint64_t ns) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.3f", ns / 1000.0);
+        return buf;
+    }
+    
+    static void appendJsonString(std::string& out, const char* s) {
+        out += '"';
+        for (; *s; ++s) {
+            if (*s == '"' || *s == '\\') out += '\\';
+            out += *s;
+        }
+        out += '"';
+    }
+    
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+    
+    std::uint64_t now() const {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+    
+    ThreadLog& local() {
+        thread_local ThreadLog* log = nullptr;
+        if (!log) {
+            std::lock_guard<std::mutex> lock(logsLock);
+            logs.push_back(std::make_unique<ThreadLog>());
+            log = logs.back().get();
+            log->tid = static_cast<int>(logs.size());
+        }
+        return *log;
+    }
+    
+    // Innermost open scope on this thread; counters are charged to it
+    static Scope*& current() {
+        thread_local Scope* scope = nullptr;
+        return scope;
+    }
+    
+    // Call once the traced threads have finished: logs are read unlocked
+    void writeChromeTrace(const std::string& path) {
+        std::lock_guard<std::mutex> lock(logsLock);
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto& log : logs) {
+            for (const Event& e : log->events) {
+                out += first ? "" : ",\n";
+                first = false;
+                out += "{\"name\":";
+                appendJsonString(out, e.name);
+                out += ",\"cat\":\"db\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(log->tid);
+                out += ",\"ts\":" + microseconds(e.startNs) + ",\"dur\":" + microseconds(e.durationNs);
+                out += ",\"args\":{\"bytesRead\":" + std::to_string(e.bytesRead) +
+                       ",\"bytesWritten\":" + std::to_string(e.bytesWritten) +
+                       ",\"records\":" + std::to_string(e.records) + "}}";
+            }
+        }
+        out += "\n]}\n";
+        std::ofstream file(path, std::ios::binary);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    }
+    
+    // Per-operation latency percentiles and totals, all threads merged
+    void writeSummary(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(logsLock);
+        std::vector<std::pair<const char*, LatencyHistogram>> merged;
+        std::uint64_t bytesRead = 0, bytesWritten = 0, records = 0, dropped = 0;
+        for (const auto& log : logs) {
+            for (const auto& h : log->histograms) {
+                auto it = merged.begin();
+                while (it != merged.end() && std::strcmp(it->first, h.first) != 0) ++it;
+                if (it == merged.end()) merged.push_back(h);
+                else it->second.merge(h.second);
+            }
+            bytesRead += log->bytesRead;
+            bytesWritten += log->bytesWritten;
+            records += log->records;
+            dropped += log->droppedEvents;
+        }
+        
+        char line[160];
+        os << "\n=== TRACE SUMMARY (microseconds) ===\n";
+        std::snprintf(line, sizeof(line), "%-24s %8s %10s %10s %10s %10s %12s\n",
+                      "operation", "count", "p50", "p90", "p99", "max", "total");
+        os << line;
+        for (const auto& m : merged) {
+            const LatencyHistogram& h = m.second;
+            std::snprintf(line, sizeof(line), "%-24s %8llu %10.1f %10.1f %10.1f %10.1f %12.1f\n", m.first,
+                          static_cast<unsigned long long>(h.count()), h.quantile(0.5) / 1000.0,
+                          h.quantile(0.9) / 1000.0, h.quantile(0.99) / 1000.0, h.max() / 1000.0,
+                          h.totalValue() / 1000.0);
+            os << line;
+        }
+        os << "bytes read: " << bytesRead << ", bytes written: " << bytesWritten
+           << ", records touched: " << records << "\n";
+        if (dropped) os << "(" << dropped << " trace events over the per-thread cap were not kept)\n";
+    }
+};
+
+// Times the enclosing block and records it as one trace event
+class Tracer::Scope {
+private:
+    const char* name;
+    std::uint64_t start;
+    Scope* outer;
+    
+public:
+    std::uint64_t bytesRead = 0;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t records = 0;
+    
+    explicit Scope(const char* name) : name(name), start(Tracer::instance().now()), outer(current()) {
+        current() = this;
+    }
+    
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    
+    ~Scope() {
+        Tracer& tracer = Tracer::instance();
+        std::uint64_t duration = tracer.now() - start;
+        current() = outer;
+        ThreadLog& log = tracer.local();
+        log.histogram(name).record(duration);
+        log.bytesRead += bytesRead;
+        log.bytesWritten += bytesWritten;
+        log.records += records;
+        if (log.events.size() < MAX_EVENTS_PER_THREAD) {
+            log.events.push_back({name, start, duration, bytesRead, bytesWritten, records});
+        } else {
+            log.droppedEvents++;
+        }
+    }
+};
+
+#define TRACE_JOIN_(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN_(a, b)
+// Times the rest of the enclosing block under `name` (a string literal)
+#define TRACE_SCOPE(name) Tracer::Scope TRACE_JOIN(traceScope_, __LINE__)(name)
+// Charge counters to the innermost TRACE_SCOPE on this thread (if any)
+#define TRACE_BYTES_READ(n) do { if (Tracer::Scope* s_ = Tracer::current()) s_->bytesRead += (n); } while (0)
+#define TRACE_BYTES_WRITTEN(n) do { if (Tracer::Scope* s_ = Tracer::current()) s_->bytesWritten += (n); } while (0)
+#define TRACE_RECORDS(n) do { if (Tracer::Scope* s_ = Tracer::current()) s_->records += (n); } while (0)
+// Writes the Chrome trace (chrome://tracing, Perfetto) and prints the summary
+#define TRACE_REPORT(path) do { \
+        Tracer::instance().writeChromeTrace(path); \
+        Tracer::instance().writeSummary(std::cout); \
+        std::cout << "Trace written to " << (path) << "\n"; \
+    } while (0)
+    
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_BYTES_READ(n) ((void)0)
+#define TRACE_BYTES_WRITTEN(n) ((void)0)
+#define TRACE_RECORDS(n) ((void)0)
+#define TRACE_REPORT(path) ((void)0)
+
+#endif
+
+#endif
@@ -7,98 +7,892 @@
 #include <cstdlib>
 #include <ctime>
 #include <limits>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <iomanip>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#if !defined(_WIN32)
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "../common/output_buffer.h"
+
+// xoshiro256** (Blackman & Vigna): small, fast, and jump() splits it into
+// non-overlapping streams, one per simulation thread
+class Xoshiro256 {
+private:
+    std::uint64_t s[4];
+    
+    static std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+    
+public:
+    explicit Xoshiro256(std::uint64_t seed) {
+        for (auto& word : s) { // splitmix64 expands the seed
+            seed += 0x9E3779B97F4A7C15ull;
+            std::uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+    
+    std::uint64_t next() {
+        const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    
+    // Advances 2^128 steps: successive jumps give independent streams
+    void jump() {
+        static const std::uint64_t JUMP[] = {0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+                                             0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull};
+        std::uint64_t t[4] = {0, 0, 0, 0};
+        for (std::uint64_t word : JUMP) {
+            for (int b = 0; b < 64; ++b) {
+                if (word & (1ull << b)) {
+                    for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+                }
+                next();
+            }
+        }
+        for (int i = 0; i < 4; ++i) s[i] = t[i];
+    }
+    
+    // Unbiased integer in [0, n) (Lemire's multiply-and-reject)
+    std::uint32_t below(std::uint32_t n) {
+        std::uint64_t m = (next() >> 32) * n;
+        std::uint32_t low = static_cast<std::uint32_t>(m);
+        if (low < n) {
+            std::uint32_t threshold = static_cast<std::uint32_t>(-n) % n;
+            while (low < threshold) {
+                m = (next() >> 32) * n;
+                low = static_cast<std::uint32_t>(m);
+            }
+        }
+        return static_cast<std::uint32_t>(m >> 32);
+    }
+    
+    // Uniform double in [0, 1)
+    double uniform() {
+        return (next() >> 11) * 0x1.0p-53;
+    }
+};
 
 class NumberGuessingGame {
+public:
+    struct Difficulty {
+        const char* name;
+        int range;
+        int maxAttempts;
+    };
+    
+    static constexpr int TIER_COUNT = 3;
+    static constexpr Difficulty TIERS[TIER_COUNT] = {
+        {"Easy", 50, 10},
+        {"Medium", 100, 7},
+        {"Hard", 200, 5}
+    };
+    
+    // What the game tells the player after a guess
+    struct Feedback {
+        int direction;   // 0 correct, -1 guess too low, +1 guess too high
+        bool veryClose;  // within 5 of the secret
+        int temperature; // 0 burning (<=5), 1 warm (<=15), 2 cold (<=30), 3 freezing
+    };
+    
+    static Feedback evaluate(int secret, int guess) {
+        // 64-bit: any int guess, however far off, has a representable distance
+        std::int64_t diff = std::llabs(static_cast<std::int64_t>(guess) - secret);
+        Feedback fb;
+        fb.direction = (guess == secret) ? 0 : (guess < secret ? -1 : 1);
+        fb.veryClose = diff <= 5;
+        fb.temperature = diff <= 5 ? 0 : diff <= 15 ? 1 : diff <= 30 ? 2 : 3;
+        return fb;
+    }
+    
+    // Temperature hints are only shown from the second attempt on
+    static bool showsTemperature(int attempts) {
+        return attempts > 1;
+    }
+    
+    static int roundScore(int maxAttempts, int attempts) {
+        return (maxAttempts - attempts + 1) * 100;
+    }
+    
 private:
     int secretNumber;
     int attempts;
     int maxAttempts;
     int range;
     int score;
+    Xoshiro256 rng;
     
     void setDifficulty() {
-        std::cout << "\nSelect Difficulty:\n";
-        std::cout << "1. Easy (1-50, 10 attempts)\n";
-        std::cout << "2. Medium (1-100, 7 attempts)\n";
-        std::cout << "3. Hard (1-200, 5 attempts)\n";
-        std::cout << "Choice: ";
+        static constexpr std::string_view MENU =
+            "\nSelect Difficulty:\n"
+            "1. Easy (1-50, 10 attempts)\n"
+            "2. Medium (1-100, 7 attempts)\n"
+            "3. Hard (1-200, 5 attempts)\n"
+            "Choice: ";
+        screen() << MENU;
+        screen().flush();
         
         int choice;
         std::cin >> choice;
         
-        switch(choice) {
-            case 1: range = 50; maxAttempts = 10; break;
-            case 2: range = 100; maxAttempts = 7; break;
-            case 3: range = 200; maxAttempts = 5; break;
-            default: range = 100; maxAttempts = 7;
-        }
+        const Difficulty& tier = (choice >= 1 && choice <= TIER_COUNT) ? TIERS[choice - 1] : TIERS[1];
+        range = tier.range;
+        maxAttempts = tier.maxAttempts;
     }
     
 public:
-    NumberGuessingGame() : score(0) {
-        srand(static_cast<unsigned>(time(0)));
-    }
+    NumberGuessingGame()
+        : score(0), rng(std::random_device{}() ^ static_cast<std::uint64_t>(time(0))) {}
     
+    // Output goes through the screen buffer, flushed once before each read
     void play() {
+        static constexpr std::string_view TEMPERATURES[] = {
+            "🔥 Burning hot!\n", "🌡️ Warm\n", "❄️ Cold\n", "🧊 Freezing\n"
+        };
+        OutputBuffer& out = screen();
         char playAgain;
         do {
             setDifficulty();
-            secretNumber = rand() % range + 1;
+            secretNumber = static_cast<int>(rng.below(range)) + 1;
             attempts = 0;
             bool won = false;
             
-            std::cout << "\nI'm thinking of a number between 1 and " << range << "...\n";
+            out << "\nI'm thinking of a number between 1 and " << range << "...\n";
             
             while (attempts < maxAttempts && !won) {
-                std::cout << "\nAttempt " << (attempts + 1) << "/" << maxAttempts << ": ";
+                out << "\nAttempt " << (attempts + 1) << "/" << maxAttempts << ": ";
+                out.flush();
                 int guess;
                 
                 if (!(std::cin >> guess)) {
-                    std::cout << "Invalid input! Please enter a number.\n";
+                    out << "Invalid input! Please enter a number.\n";
                     std::cin.clear();
                     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                     continue;
                 }
                 
                 attempts++;
+                Feedback fb = evaluate(secretNumber, guess);
                 
-                if (guess == secretNumber) {
-                    std::cout << "🎉 Correct! You guessed it in " << attempts << " attempts!\n";
-                    int roundScore = (maxAttempts - attempts + 1) * 100;
-                    score += roundScore;
-                    std::cout << "Round score: " << roundScore << " | Total: " << score << "\n";
+                if (fb.direction == 0) {
+                    out << "🎉 Correct! You guessed it in " << attempts << " attempts!\n";
+                    int points = roundScore(maxAttempts, attempts);
+                    score += points;
+                    out << "Round score: " << points << " | Total: " << score << "\n";
                     won = true;
                 }
-                else if (guess < secretNumber) {
-                    std::cout << "Too low! ";
-                    if (abs(guess - secretNumber) <= 5) std::cout << "(Very close!)";
-                    std::cout << "\n";
-                }
                 else {
-                    std::cout << "Too high! ";
-                    if (abs(guess - secretNumber) <= 5) std::cout << "(Very close!)";
-                    std::cout << "\n";
+                    out << (fb.direction < 0 ? "Too low! " : "Too high! ");
+                    if (fb.veryClose) out << "(Very close!)";
+                    out << "\n";
                 }
                 
                 // Temperature hint
-                if (attempts > 1 && !won) {
-                    int diff = abs(guess - secretNumber);
-                    if (diff <= 5) std::cout << "🔥 Burning hot!\n";
-                    else if (diff <= 15) std::cout << "🌡️ Warm\n";
-                    else if (diff <= 30) std::cout << "❄️ Cold\n";
-                    else std::cout << "🧊 Freezing\n";
-                }
+                if (showsTemperature(attempts) && !won) out << TEMPERATURES[fb.temperature];
             }
             
             if (!won) {
-                std::cout << "\nGame Over! The number was: " << secretNumber << "\n";
+                out << "\nGame Over! The number was: " << secretNumber << "\n";
             }
             
-            std::cout << "\nPlay again? (y/n): ";
+            out << "\nPlay again? (y/n): ";
+            out.flush();
             std::cin >> playAgain;
         } while (playAgain == 'y' || playAgain == 'Y');
         
-        std::cout << "Final Score: " << score << "\n";
+        out << "Final Score: " << score << "\n";
+        out.flush();
+    }
+};
+
+// ============================================================
+// GUESSING STRATEGY SIMULATOR
+// Headless Monte Carlo rounds to tune tiers and scoring
+// ============================================================
+
+// A simulated player. One instance per thread; reset() starts a new round.
+class Guesser {
+public:
+    virtual ~Guesser() = default;
+    virtual const char* name() const = 0;
+    virtual void reset(int range) = 0;
+    virtual int guess(Xoshiro256& rng) = 0;
+    virtual void observe(int guess, int attempt, const NumberGuessingGame::Feedback& fb) = 0;
+    virtual std::unique_ptr<Guesser> clone() const = 0;
+};
+
+// Halves the remaining interval every time
+class BinarySearchGuesser : public Guesser {
+protected:
+    int lo = 1;
+    int hi = 1;
+    
+public:
+    const char* name() const override { return "binary search"; }
+    void reset(int range) override { lo = 1; hi = range; }
+    int guess(Xoshiro256&) override { return lo + (hi - lo) / 2; }
+    void observe(int g, int, const NumberGuessingGame::Feedback& fb) override {
+        if (fb.direction < 0) lo = g + 1;
+        else if (fb.direction > 0) hi = g - 1;
+    }
+    std::unique_ptr<Guesser> clone() const override { return std::make_unique<BinarySearchGuesser>(*this); }
+};
+
+// Roughly bisects but aims sloppily and likes round numbers
+class NoisyHumanGuesser : public BinarySearchGuesser {
+private:
+    double noise;     // aim error as a fraction of the remaining interval
+    double roundBias; // chance of snapping to a multiple of 5
+    
+public:
+    explicit NoisyHumanGuesser(double noise = 0.25, double roundBias = 0.3)
+        : noise(noise), roundBias(roundBias) {}
+        
+    const char* name() const override { return "noisy human"; }
+    
+    int guess(Xoshiro256& rng) override {
+        // Sum of three uniforms: cheap bell-shaped error around the midpoint
+        double err = (rng.uniform() + rng.uniform() + rng.uniform() - 1.5) / 1.5;
+        int g = lo + (hi - lo) / 2 + static_cast<int>(err * noise * (hi - lo + 1));
+        if (rng.uniform() < roundBias) g = (g + 2) / 5 * 5;
+        return std::min(std::max(g, lo), hi);
+    }
+    
+    std::unique_ptr<Guesser> clone() const override { return std::make_unique<NoisyHumanGuesser>(*this); }
+};
+
+// Bisects, and also narrows the interval with the "very close" and
+// temperature hints
+class HintAwareGuesser : public BinarySearchGuesser {
+public:
+    const char* name() const override { return "hint-aware"; }
+    
+    void observe(int g, int attempt, const NumberGuessingGame::Feedback& fb) override {
+        BinarySearchGuesser::observe(g, attempt, fb);
+        if (fb.direction == 0) return;
+        
+        // Distance band implied by the hints
+        int nearest = 1;
+        int farthest = std::numeric_limits<int>::max() / 2;
+        if (fb.veryClose) farthest = 5;
+        else nearest = 6;
+        if (NumberGuessingGame::showsTemperature(attempt)) {
+            static const int BAND_LO[] = {1, 6, 16, 31};
+            static const int BAND_HI[] = {5, 15, 30, std::numeric_limits<int>::max() / 2};
+            nearest = std::max(nearest, BAND_LO[fb.temperature]);
+            farthest = std::min(farthest, BAND_HI[fb.temperature]);
+        }
+        if (fb.direction < 0) {
+            lo = std::max(lo, g + nearest);
+            hi = std::min(hi, g + farthest);
+        } else {
+            lo = std::max(lo, g - farthest);
+            hi = std::min(hi, g - nearest);
+        }
+    }
+    
+    std::unique_ptr<Guesser> clone() const override { return std::make_unique<HintAwareGuesser>(*this); }
+};
+
+class GuessingSimulator {
+public:
+    // Outcome counts for one (tier, strategy) pair
+    struct Result {
+        std::vector<std::uint64_t> winsByAttempt; // index = attempts used
+        std::uint64_t losses = 0;
+        std::uint64_t rounds = 0;
+        
+        void merge(const Result& o) {
+            if (winsByAttempt.size() < o.winsByAttempt.size()) winsByAttempt.resize(o.winsByAttempt.size());
+            for (size_t i = 0; i < o.winsByAttempt.size(); ++i) winsByAttempt[i] += o.winsByAttempt[i];
+            losses += o.losses;
+            rounds += o.rounds;
+        }
+    };
+    
+private:
+    std::uint64_t seed;
+    unsigned threads;
+    
+    static void playRounds(const NumberGuessingGame::Difficulty& tier, Guesser& player,
+                           Xoshiro256& rng, std::uint64_t rounds, Result& out) {
+        out.winsByAttempt.assign(tier.maxAttempts + 1, 0);
+        for (std::uint64_t r = 0; r < rounds; ++r) {
+            int secret = static_cast<int>(rng.below(tier.range)) + 1;
+            player.reset(tier.range);
+            bool won = false;
+            for (int attempt = 1; attempt <= tier.maxAttempts; ++attempt) {
+                int g = player.guess(rng);
+                NumberGuessingGame::Feedback fb = NumberGuessingGame::evaluate(secret, g);
+                if (fb.direction == 0) {
+                    out.winsByAttempt[attempt]++;
+                    won = true;
+                    break;
+                }
+                player.observe(g, attempt, fb);
+            }
+            if (!won) out.losses++;
+        }
+        out.rounds += rounds;
+    }
+    
+public:
+    explicit GuessingSimulator(std::uint64_t seed = 0x5EED,
+                               unsigned threads = std::thread::hardware_concurrency())
+        : seed(seed), threads(threads ? threads : 1) {}
+        
+    // Splits `rounds` across all threads, each on its own PRNG stream
+    Result run(const NumberGuessingGame::Difficulty& tier, const Guesser& strategy, std::uint64_t rounds) {
+        std::vector<Result> partial(threads);
+        std::vector<std::thread> pool;
+        Xoshiro256 stream(seed);
+        for (unsigned t = 0; t < threads; ++t) {
+            std::uint64_t share = rounds / threads + (t < rounds % threads ? 1 : 0);
+            pool.emplace_back([&tier, &strategy, &partial, stream, share, t]() mutable {
+                std::unique_ptr<Guesser> player = strategy.clone();
+                playRounds(tier, *player, stream, share, partial[t]);
+            });
+            stream.jump();
+        }
+        for (auto& th : pool) th.join();
+        
+        Result total;
+        for (const auto& p : partial) total.merge(p);
+        return total;
+    }
+    
+    // Score at quantile q (0..1) of all rounds, losses scoring 0
+    static int scoreQuantile(const Result& r, int maxAttempts, double q) {
+        std::uint64_t target = static_cast<std::uint64_t>(q * r.rounds);
+        std::uint64_t seen = r.losses;
+        if (seen > target) return 0;
+        for (int a = static_cast<int>(r.winsByAttempt.size()) - 1; a >= 1; --a) {
+            seen += r.winsByAttempt[a];
+            if (seen > target) return NumberGuessingGame::roundScore(maxAttempts, a);
+        }
+        return NumberGuessingGame::roundScore(maxAttempts, 1);
+    }
+    
+    void report(std::uint64_t roundsPerCell) {
+        BinarySearchGuesser binary;
+        NoisyHumanGuesser human;
+        HintAwareGuesser hints;
+        const Guesser* strategies[] = {&binary, &human, &hints};
+        
+        std::cout << "Simulating " << roundsPerCell << " rounds per tier and strategy on "
+                  << threads << " threads\n";
+        for (const auto& tier : NumberGuessingGame::TIERS) {
+            std::cout << "\n" << tier.name << " (1-" << tier.range << ", " << tier.maxAttempts << " attempts)\n";
+            std::cout << std::left << std::setw(16) << "strategy" << std::right
+                      << std::setw(9) << "win %" << std::setw(11) << "avg score"
+                      << std::setw(7) << "p10" << std::setw(7) << "p50" << std::setw(7) << "p90"
+                      << std::setw(14) << "rounds/s" << "\n";
+            for (const Guesser* strategy : strategies) {
+                auto start = std::chrono::steady_clock::now();
+                Result r = run(tier, *strategy, roundsPerCell);
+                double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                
+                double totalScore = 0;
+                for (size_t a = 1; a < r.winsByAttempt.size(); ++a) {
+                    totalScore += static_cast<double>(r.winsByAttempt[a]) *
+                                  NumberGuessingGame::roundScore(tier.maxAttempts, static_cast<int>(a));
+                }
+                std::cout << std::left << std::setw(16) << strategy->name() << std::right << std::fixed
+                          << std::setprecision(2) << std::setw(9) << 100.0 * (r.rounds - r.losses) / r.rounds
+                          << std::setprecision(1) << std::setw(11) << totalScore / r.rounds
+                          << std::setw(7) << scoreQuantile(r, tier.maxAttempts, 0.10)
+                          << std::setw(7) << scoreQuantile(r, tier.maxAttempts, 0.50)
+                          << std::setw(7) << scoreQuantile(r, tier.maxAttempts, 0.90)
+                          << std::setprecision(0) << std::setw(14) << r.rounds / secs << "\n";
+            }
+        }
+    }
+};
+
+// ============================================================
+// GUESSING SESSION SERVER
+// Many concurrent games behind a newline-delimited protocol
+// ============================================================
+
+// Sessions live in fixed-size slots spread over independently locked shards.
+// A session ID encodes generation, slot and shard, so lookups are O(1) and
+// IDs of closed sessions never alias a reused slot. Guesses never allocate.
+class GuessingSessionManager {
+public:
+    enum class Status { Low, High, Won, Lost, Finished, Unknown, OutOfRange };
+    
+    struct GuessResult {
+        Status status;
+        NumberGuessingGame::Feedback feedback;
+        int attemptsLeft;
+        int temperature;  // -1 when the game would not show it yet
+        int roundScore;
+        int totalScore;
+        int secret;       // revealed on a loss
+    };
+    
+    struct RoundInfo {
+        std::uint64_t id;
+        int range;
+        int maxAttempts;
+    };
+    
+private:
+    static constexpr unsigned SHARD_BITS = 6;
+    static constexpr unsigned SHARDS = 1u << SHARD_BITS;
+    
+    struct Session {
+        std::uint32_t generation = 0;
+        std::uint16_t secret = 0;
+        std::uint8_t tier = 0;
+        std::uint8_t attempts = 0;
+        bool open = false;
+        bool finished = false;
+        int score = 0;
+    };
+    
+    struct alignas(64) Shard {
+        std::mutex lock;
+        std::vector<Session> slots;
+        std::vector<std::uint32_t> freeSlots;
+        Xoshiro256 rng{0};
+        size_t live = 0;
+    };
+    
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<unsigned> nextShard{0};
+    
+    static std::uint64_t makeId(std::uint32_t generation, std::uint32_t slot, unsigned shard) {
+        return (static_cast<std::uint64_t>(generation) << 32) |
+               (static_cast<std::uint64_t>(slot) << SHARD_BITS) | shard;
+    }
+    
+    // Locked lookup; returns nullptr for unknown or stale IDs
+    Session* find(Shard& sh, std::uint64_t id) {
+        std::uint32_t slot = static_cast<std::uint32_t>(id & 0xFFFFFFFFu) >> SHARD_BITS;
+        if (slot >= sh.slots.size()) return nullptr;
+        Session& s = sh.slots[slot];
+        if (!s.open || s.generation != static_cast<std::uint32_t>(id >> 32)) return nullptr;
+        return &s;
+    }
+    
+    Shard& shardOf(std::uint64_t id) {
+        return shards[id & (SHARDS - 1)];
+    }
+    
+    static void startRound(Shard& sh, Session& s, int tier) {
+        const auto& t = NumberGuessingGame::TIERS[tier];
+        s.tier = static_cast<std::uint8_t>(tier);
+        s.secret = static_cast<std::uint16_t>(sh.rng.below(t.range) + 1);
+        s.attempts = 0;
+        s.finished = false;
+    }
+    
+    static RoundInfo roundInfo(std::uint64_t id, int tier) {
+        const auto& t = NumberGuessingGame::TIERS[tier];
+        return {id, t.range, t.maxAttempts};
+    }
+    
+public:
+    // `capacity` slots are reserved up front so opening sessions does not
+    // allocate until the slab outgrows it
+    explicit GuessingSessionManager(size_t capacity = 4096,
+                                    std::uint64_t seed = std::random_device{}())
+        : shards(new Shard[SHARDS]) {
+        Xoshiro256 stream(seed);
+        for (unsigned i = 0; i < SHARDS; ++i) {
+            shards[i].rng = stream;
+            shards[i].slots.reserve(capacity / SHARDS + 1);
+            shards[i].freeSlots.reserve(capacity / SHARDS + 1);
+            stream.jump();
+        }
+    }
+    
+    static bool validTier(int tier) {
+        return tier >= 0 && tier < NumberGuessingGame::TIER_COUNT;
+    }
+    
+    RoundInfo open(int tier) {
+        unsigned shardIndex = nextShard.fetch_add(1, std::memory_order_relaxed) & (SHARDS - 1);
+        Shard& sh = shards[shardIndex];
+        std::lock_guard<std::mutex> guard(sh.lock);
+        std::uint32_t slot;
+        if (!sh.freeSlots.empty()) {
+            slot = sh.freeSlots.back();
+            sh.freeSlots.pop_back();
+        } else {
+            slot = static_cast<std::uint32_t>(sh.slots.size());
+            sh.slots.emplace_back();
+        }
+        Session& s = sh.slots[slot];
+        s.open = true;
+        s.score = 0;
+        startRound(sh, s, tier);
+        sh.live++;
+        return roundInfo(makeId(s.generation, slot, shardIndex), tier);
+    }
+    
+    // Starts another round in an existing session, keeping its total score
+    bool again(std::uint64_t id, int tier, RoundInfo& info) {
+        Shard& sh = shardOf(id);
+        std::lock_guard<std::mutex> guard(sh.lock);
+        Session* s = find(sh, id);
+        if (!s) return false;
+        startRound(sh, *s, tier);
+        info = roundInfo(id, tier);
+        return true;
+    }
+    
+    GuessResult guess(std::uint64_t id, int value) {
+        GuessResult r{Status::Unknown, {0, false, 0}, 0, -1, 0, 0, 0};
+        Shard& sh = shardOf(id);
+        std::lock_guard<std::mutex> guard(sh.lock);
+        Session* s = find(sh, id);
+        if (!s) return r;
+        r.totalScore = s->score;
+        if (s->finished) {
+            r.status = Status::Finished;
+            return r;
+        }
+        
+        const auto& tier = NumberGuessingGame::TIERS[s->tier];
+        if (value < 1 || value > tier.range) { // not counted as an attempt
+            r.status = Status::OutOfRange;
+            return r;
+        }
+        s->attempts++;
+        r.feedback = NumberGuessingGame::evaluate(s->secret, value);
+        r.attemptsLeft = tier.maxAttempts - s->attempts;
+        if (r.feedback.direction == 0) {
+            r.status = Status::Won;
+            r.roundScore = NumberGuessingGame::roundScore(tier.maxAttempts, s->attempts);
+            s->score += r.roundScore;
+            s->finished = true;
+        } else if (r.attemptsLeft == 0) {
+            r.status = Status::Lost;
+            r.secret = s->secret;
+            s->finished = true;
+        } else {
+            r.status = r.feedback.direction < 0 ? Status::Low : Status::High;
+            if (NumberGuessingGame::showsTemperature(s->attempts)) r.temperature = r.feedback.temperature;
+        }
+        r.totalScore = s->score;
+        return r;
+    }
+    
+    // Frees the slot; returns false for unknown IDs
+    bool close(std::uint64_t id, int& finalScore) {
+        Shard& sh = shardOf(id);
+        std::lock_guard<std::mutex> guard(sh.lock);
+        Session* s = find(sh, id);
+        if (!s) return false;
+        finalScore = s->score;
+        s->open = false;
+        s->generation++;
+        sh.freeSlots.push_back(static_cast<std::uint32_t>(s - sh.slots.data()));
+        sh.live--;
+        return true;
+    }
+    
+    size_t liveSessions() {
+        size_t total = 0;
+        for (unsigned i = 0; i < SHARDS; ++i) {
+            std::lock_guard<std::mutex> guard(shards[i].lock);
+            total += shards[i].live;
+        }
+        return total;
     }
 };
 
+// Line protocol, one request per line, one response line each:
+//   NEW [tier]          -> OK <id> <range> <maxAttempts>       (tier 1-3, default 2)
+//   AGAIN <id> [tier]   -> OK <id> <range> <maxAttempts>
+//   GUESS <id> <n>      -> LOW|HIGH <attemptsLeft> <veryClose 0/1> <temperature 0-3, -1 hidden>
+//                          WIN <roundScore> <totalScore> | LOSE <secret> <totalScore>
+//                          ERR range when n is outside 1..range
+//   END <id>            -> BYE <totalScore>
+//   STATS               -> STATS <liveSessions>
+//   anything else       -> ERR <reason>
+class GuessingServer {
+private:
+    GuessingSessionManager& sessions;
+    
+    // Appends without allocating; `out` is a fixed caller buffer
+    struct Writer {
+        char* p;
+        char* end;
+        
+        Writer& operator<<(const char* s) {
+            while (*s && p < end) *p++ = *s++;
+            return *this;
+        }
+        
+        Writer& operator<<(std::int64_t v) {
+            if (p < end) *p++ = ' ';
+            p = std::to_chars(p, end, v).ptr;
+            return *this;
+        }
+    };
+    
+    static std::string_view nextToken(std::string_view& line) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos) {
+            line = {};
+            return {};
+        }
+        size_t stop = line.find_first_of(" \t\r", start);
+        if (stop == std::string_view::npos) stop = line.size();
+        std::string_view token = line.substr(start, stop - start);
+        line.remove_prefix(stop);
+        return token;
+    }
+    
+    template <typename T>
+    static bool parse(std::string_view token, T& value) {
+        if (token.empty()) return false;
+        auto res = std::from_chars(token.data(), token.data() + token.size(), value);
+        return res.ec == std::errc() && res.ptr == token.data() + token.size();
+    }
+    
+    // Optional 1-based tier argument; default Medium
+    static bool parseTier(std::string_view token, int& tier) {
+        tier = 1;
+        if (token.empty()) return true;
+        int oneBased;
+        if (!parse(token, oneBased) || !GuessingSessionManager::validTier(oneBased - 1)) return false;
+        tier = oneBased - 1;
+        return true;
+    }
+    
+    static void writeRound(Writer& w, const GuessingSessionManager::RoundInfo& info) {
+        w << "OK" << static_cast<std::int64_t>(info.id) << info.range << info.maxAttempts;
+    }
+    
+public:
+    static constexpr size_t MAX_RESPONSE = 128;
+    static constexpr size_t MAX_REQUEST = 1 << 14; // longer lines are rejected
+    
+    explicit GuessingServer(GuessingSessionManager& sessions) : sessions(sessions) {}
+    
+    // Handles one request line; writes the response (with '\n') into out
+    size_t handle(std::string_view line, char* out) {
+        Writer w{out, out + MAX_RESPONSE - 1};
+        std::string_view cmd = nextToken(line);
+        std::uint64_t id;
+        int tier;
+        
+        if (cmd == "GUESS") {
+            int value;
+            if (!parse(nextToken(line), id) || !parse(nextToken(line), value)) {
+                w << "ERR usage: GUESS <id> <n>";
+            } else {
+                auto r = sessions.guess(id, value);
+                using Status = GuessingSessionManager::Status;
+                switch (r.status) {
+                    case Status::Low:
+                    case Status::High:
+                        w << (r.status == Status::Low ? "LOW" : "HIGH") << r.attemptsLeft
+                          << (r.feedback.veryClose ? 1 : 0) << r.temperature;
+                        break;
+                    case Status::Won: w << "WIN" << r.roundScore << r.totalScore; break;
+                    case Status::Lost: w << "LOSE" << r.secret << r.totalScore; break;
+                    case Status::Finished: w << "ERR round over, send AGAIN or END"; break;
+                    case Status::Unknown: w << "ERR unknown session"; break;
+                    case Status::OutOfRange: w << "ERR range"; break;
+                }
+            }
+        }
+        else if (cmd == "NEW") {
+            if (!parseTier(nextToken(line), tier)) w << "ERR tier must be 1-3";
+            else writeRound(w, sessions.open(tier));
+        }
+        else if (cmd == "AGAIN") {
+            GuessingSessionManager::RoundInfo info;
+            if (!parse(nextToken(line), id)) w << "ERR usage: AGAIN <id> [tier]";
+            else if (!parseTier(nextToken(line), tier)) w << "ERR tier must be 1-3";
+            else if (!sessions.again(id, tier, info)) w << "ERR unknown session";
+            else writeRound(w, info);
+        }
+        else if (cmd == "END") {
+            int finalScore;
+            if (!parse(nextToken(line), id)) w << "ERR usage: END <id>";
+            else if (!sessions.close(id, finalScore)) w << "ERR unknown session";
+            else w << "BYE" << finalScore;
+        }
+        else if (cmd == "STATS") {
+            w << "STATS" << static_cast<std::int64_t>(sessions.liveSessions());
+        }
+        else {
+            w << "ERR unknown command";
+        }
+        *w.p++ = '\n';
+        return static_cast<size_t>(w.p - out);
+    }
+    
+    // Serves requests from `in` until EOF. Output is flushed whenever no
+    // further input is already buffered, so pipelined clients are batched.
+    void serve(std::istream& in, std::ostream& out) {
+        static constexpr std::string_view TOO_LONG = "ERR line too long\n";
+        char line[MAX_REQUEST];
+        char response[MAX_RESPONSE];
+        while (in.getline(line, sizeof(line)) || in.gcount() == sizeof(line) - 1) {
+            if (in.fail()) {
+                in.clear();
+                in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                out.write(TOO_LONG.data(), static_cast<std::streamsize>(TOO_LONG.size()));
+            } else {
+                out.write(response, static_cast<std::streamsize>(handle(line, response)));
+            }
+            if (in.rdbuf()->in_avail() <= 0) out.flush();
+        }
+        out.flush();
+    }
+    
+#if !defined(_WIN32)
+    // Listens on a Unix domain socket; one thread per connection, all
+    // sharing the session manager. Returns only on failure, and only after
+    // every connection thread has stopped.
+    bool serveUnixSocket(const std::string& path) {
+        int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (listener < 0 || path.size() >= sizeof(addr.sun_path)) return false;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        // Only a stale socket from an earlier run may be replaced
+        struct stat existing;
+        if (::lstat(path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                std::cerr << path << " exists and is not a socket; refusing to replace it.\n";
+                ::close(listener);
+                return false;
+            }
+            ::unlink(path.c_str());
+        }
+        if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listener, 128) != 0) {
+            ::close(listener);
+            return false;
+        }
+        // A client that hangs up before reading its replies must cost only
+        // its own connection: writes then fail with EPIPE instead of killing
+        // the process.
+        std::signal(SIGPIPE, SIG_IGN);
+        
+        // The accept loop owns every connection: it joins finished threads
+        // and closes their sockets, and on the way out it shuts the live
+        // sockets down and waits, so no thread outlives this call.
+        std::vector<std::unique_ptr<Connection>> connections;
+        auto reap = [&connections] {
+            for (auto it = connections.begin(); it != connections.end();) {
+                if (!(*it)->done) {
+                    ++it;
+                    continue;
+                }
+                (*it)->thread.join();
+                ::close((*it)->fd);
+                it = connections.erase(it);
+            }
+        };
+        while (true) {
+            int client = ::accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            reap();
+            connections.push_back(std::make_unique<Connection>(client));
+            Connection* c = connections.back().get();
+            c->thread = std::thread([this, c] {
+                serveConnection(c->fd);
+                ::shutdown(c->fd, SHUT_RDWR); // the peer sees EOF now; the fd stays ours until reaped
+                c->done = true;
+            });
+        }
+        ::close(listener);
+        for (auto& c : connections) ::shutdown(c->fd, SHUT_RDWR);
+        for (auto& c : connections) {
+            c->thread.join();
+            ::close(c->fd);
+        }
+        return false;
+    }
+    
+private:
+    struct Connection {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> done{false};
+        explicit Connection(int fd) : fd(fd) {}
+    };
+    
+    static bool writeAll(int fd, const char* data, size_t size) {
+        for (size_t done = 0; done < size;) {
+            ssize_t w = ::write(fd, data + done, size - done);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false; // EPIPE or reset: the client is gone
+            done += static_cast<size_t>(w);
+        }
+        return true;
+    }
+    
+    // Replies collect in a fixed buffer that is written out whenever the
+    // next one might not fit and once per read, so nothing allocates per
+    // request. The owner closes fd.
+    void serveConnection(int fd) {
+        char in[MAX_REQUEST];
+        char out[1 << 14];
+        size_t have = 0;
+        size_t pending = 0;
+        while (true) {
+            ssize_t n = ::read(fd, in + have, sizeof(in) - have);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            have += static_cast<size_t>(n);
+            
+            size_t start = 0;
+            for (size_t i = 0; i < have; ++i) {
+                if (in[i] != '\n') continue;
+                if (sizeof(out) - pending < MAX_RESPONSE) {
+                    if (!writeAll(fd, out, pending)) return;
+                    pending = 0;
+                }
+                pending += handle(std::string_view(in + start, i - start), out + pending);
+                start = i + 1;
+            }
+            if (start == 0 && have == sizeof(in)) return; // line longer than the buffer
+            std::memmove(in, in + start, have - start);
+            have -= start;
+            
+            if (!writeAll(fd, out, pending)) return;
+            pending = 0;
+        }
+    }
+#endif
+};
@@ -9,10 +9,380 @@
 #include <string>
 #include <iomanip>
 #include <limits>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+#include "../common/output_buffer.h"
+
+// ============================================================
+// PRECISION MODES
+// Range-reduced polynomial kernels for the scientific functions.
+// Worst-case relative error against libm (trig arguments up to
+// REDUCTION_LIMIT), checked by --check-precision:
+//   Exact   libm itself
+//   Fast    sin, cos, tan, log, pow within 1e-9
+//   Approx  sin, cos, tan, log, pow within 1e-5
+// Only the trig kernels are reliably faster than libm (roughly 1.3x
+// to 2.5x on --bench-precision). glibc's table-driven log is at
+// least as fast as the Fast series and only a little slower than
+// Approx, and pow is no faster in any mode: it pays for a
+// full-precision log plus exp. log and pow have modes so a caller
+// can pick one precision for every function, not for speed.
+// sqrt is libm in every mode: the hardware instruction is already
+// correctly rounded and faster than a polynomial.
+// Inputs a kernel does not cover (huge angles, zero or negative
+// logs, inf, NaN, powers that would overflow or go subnormal) fall
+// back to libm.
+// ============================================================
+
+class FastMath {
+public:
+    enum class Precision { Exact, Fast, Approx };
+    
+    static constexpr double REDUCTION_LIMIT = 1e6; // k * PIO2_1 is exact while k < 2^20
+    
+private:
+    // pi/2 in three 33-bit parts (fdlibm), so k * part is exact
+    static constexpr double PIO2_1 = 1.57079632673412561417e+00;
+    static constexpr double PIO2_2 = 6.07710050630396597660e-11;
+    static constexpr double PIO2_3 = 2.02226624871116645580e-21;
+    static constexpr double TWO_OVER_PI = 6.36619772367581382433e-01;
+    static constexpr double LN2_HI = 6.93147180369123816490e-01; // 32 significant bits
+    static constexpr double LN2_LO = 1.90821492927058770002e-10;
+    static constexpr double LOG2_E = 1.44269504088896338700e+00;
+    static constexpr double SQRT2 = 1.41421356237309514547e+00;
+    static constexpr double EXP_LIMIT = 708.0;  // exp stays a normal double inside +-EXP_LIMIT
+    static constexpr double ROUNDER = 6755399441055744.0; // 1.5 * 2^52: adding it rounds to an integer
+    
+    static double roundToInt(double v) { return (v + ROUNDER) - ROUNDER; }
+    
+    // x = k * pi/2 + r with |r| <= pi/4; quadrant = k mod 4
+    static double reduce(double x, int& quadrant) {
+        double k = roundToInt(x * TWO_OVER_PI);
+        quadrant = static_cast<int>(static_cast<long long>(k) & 3);
+        return ((x - k * PIO2_1) - k * PIO2_2) - k * PIO2_3;
+    }
+    
+    // Taylor kernels on |r| <= pi/4. Fast keeps terms to r^11 / r^10
+    // (error < 2e-10), Approx to r^7 / r^6 (error < 6e-6).
+    template <Precision P>
+    static double sinKernel(double r) {
+        double z = r * r;
+        if constexpr (P == Precision::Fast) {
+            return r + r * z * (-1.0 / 6 + z * (1.0 / 120 + z * (-1.0 / 5040 + z * (1.0 / 362880 +
+                                 z * (-1.0 / 39916800)))));
+        } else {
+            return r + r * z * (-1.0 / 6 + z * (1.0 / 120 + z * (-1.0 / 5040)));
+        }
+    }
+    
+    template <Precision P>
+    static double cosKernel(double r) {
+        double z = r * r;
+        if constexpr (P == Precision::Fast) {
+            return 1.0 + z * (-0.5 + z * (1.0 / 24 + z * (-1.0 / 720 + z * (1.0 / 40320 +
+                              z * (-1.0 / 3628800)))));
+        } else {
+            return 1.0 + z * (-0.5 + z * (1.0 / 24 + z * (-1.0 / 720)));
+        }
+    }
+    
+    template <Precision P>
+    static double sinOf(double x) {
+        if (!(std::fabs(x) <= REDUCTION_LIMIT)) return std::sin(x);
+        int q;
+        double r = reduce(x, q);
+        switch (q) {
+            case 0: return sinKernel<P>(r);
+            case 1: return cosKernel<P>(r);
+            case 2: return -sinKernel<P>(r);
+            default: return -cosKernel<P>(r);
+        }
+    }
+    
+    template <Precision P>
+    static double cosOf(double x) {
+        if (!(std::fabs(x) <= REDUCTION_LIMIT)) return std::cos(x);
+        int q;
+        double r = reduce(x, q);
+        switch (q) {
+            case 0: return cosKernel<P>(r);
+            case 1: return -sinKernel<P>(r);
+            case 2: return -cosKernel<P>(r);
+            default: return sinKernel<P>(r);
+        }
+    }
+    
+    // Both kernels stay relatively accurate near the poles, so the quotient does too
+    template <Precision P>
+    static double tanOf(double x) {
+        if (!(std::fabs(x) <= REDUCTION_LIMIT)) return std::tan(x);
+        int q;
+        double r = reduce(x, q);
+        double s = sinKernel<P>(r);
+        double c = cosKernel<P>(r);
+        return (q & 1) ? -c / s : s / c;
+    }
+    
+    // x = 2^e * m with sqrt(1/2) <= m < sqrt(2); log(m) = 2 atanh(s),
+    // s = (m - 1) / (m + 1), |s| < 0.172. Fast sums the series to s^15
+    // (error < 4e-14, accurate enough to feed pow), Approx to s^5 (< 4e-6).
+    template <Precision P>
+    static double logOf(double x) {
+        if (!(x >= DBL_MIN && x <= DBL_MAX)) return std::log(x);
+        std::uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int e = static_cast<int>(bits >> 52) - 1023;
+        bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+        double m;
+        std::memcpy(&m, &bits, sizeof(m));
+        if (m > SQRT2) {
+            m *= 0.5;
+            e++;
+        }
+        double s = (m - 1.0) / (m + 1.0);
+        double z = s * s;
+        double series;
+        if constexpr (P == Precision::Fast) {
+            // Estrin's scheme: shorter dependency chain than Horner
+            double z2 = z * z;
+            double z4 = z2 * z2;
+            series = (1.0 / 3 + z * (1.0 / 5)) + z2 * (1.0 / 7 + z * (1.0 / 9)) +
+                     z4 * ((1.0 / 11 + z * (1.0 / 13)) + z2 * (1.0 / 15));
+        } else {
+            series = 1.0 / 3 + z * (1.0 / 5);
+        }
+        double logM = 2.0 * s + 2.0 * s * z * series;
+        return e * LN2_HI + (logM + e * LN2_LO);
+    }
+    
+    // exp(y) = 2^k * exp(r), |r| <= ln2 / 2. Fast keeps terms to r^9
+    // (error < 1e-11), Approx to r^5 (< 4e-6). Caller keeps |y| <= EXP_LIMIT.
+    template <Precision P>
+    static double expOf(double y) {
+        double k = roundToInt(y * LOG2_E);
+        double r = (y - k * LN2_HI) - k * LN2_LO;
+        double p;
+        if constexpr (P == Precision::Fast) {
+            double r2 = r * r;
+            double r4 = r2 * r2;
+            p = ((1.0 + r) + r2 * (1.0 / 2 + r * (1.0 / 6))) +
+                r4 * (((1.0 / 24 + r * (1.0 / 120)) + r2 * (1.0 / 720 + r * (1.0 / 5040))) +
+                      r4 * (1.0 / 40320 + r * (1.0 / 362880)));
+        } else {
+            p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120)))));
+        }
+        std::uint64_t bits = static_cast<std::uint64_t>(static_cast<long long>(k) + 1023) << 52;
+        double scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+    
+    // a^b = exp(b log a). log always uses the Fast kernel: its error is
+    // multiplied by |b log a|, which can reach EXP_LIMIT. That log is
+    // what keeps every pow mode at libm speed; the mode only trades
+    // accuracy in the exp step.
+    template <Precision P>
+    static double powOf(double a, double b) {
+        if (!(a > 0 && a <= DBL_MAX) || !std::isfinite(b)) return std::pow(a, b);
+        double y = b * logOf<Precision::Fast>(a);
+        if (!(std::fabs(y) <= EXP_LIMIT)) return std::pow(a, b);
+        return expOf<P>(y);
+    }
+    
+public:
+    static const char* name(Precision p) {
+        switch (p) {
+            case Precision::Fast: return "fast";
+            case Precision::Approx: return "approx";
+            default: return "exact";
+        }
+    }
+    
+    // Documented worst-case relative error; 0 for libm
+    static double errorBound(Precision p) {
+        switch (p) {
+            case Precision::Fast: return 1e-9;
+            case Precision::Approx: return 1e-5;
+            default: return 0;
+        }
+    }
+    
+    static double sin(double x, Precision p) {
+        switch (p) {
+            case Precision::Fast: return sinOf<Precision::Fast>(x);
+            case Precision::Approx: return sinOf<Precision::Approx>(x);
+            default: return std::sin(x);
+        }
+    }
+    
+    static double cos(double x, Precision p) {
+        switch (p) {
+            case Precision::Fast: return cosOf<Precision::Fast>(x);
+            case Precision::Approx: return cosOf<Precision::Approx>(x);
+            default: return std::cos(x);
+        }
+    }
+    
+    static double tan(double x, Precision p) {
+        switch (p) {
+            case Precision::Fast: return tanOf<Precision::Fast>(x);
+            case Precision::Approx: return tanOf<Precision::Approx>(x);
+            default: return std::tan(x);
+        }
+    }
+    
+    static double log(double x, Precision p) {
+        switch (p) {
+            case Precision::Fast: return logOf<Precision::Fast>(x);
+            case Precision::Approx: return logOf<Precision::Approx>(x);
+            default: return std::log(x);
+        }
+    }
+    
+    static double pow(double a, double b, Precision p) {
+        switch (p) {
+            case Precision::Fast: return powOf<Precision::Fast>(a, b);
+            case Precision::Approx: return powOf<Precision::Approx>(a, b);
+            default: return std::pow(a, b);
+        }
+    }
+    
+    static double sqrt(double x, Precision) { return std::sqrt(x); }
+    
+    // ---- verification and benchmark (--check-precision, --bench-precision) ----
+    
+private:
+    enum class Function { Sin, Cos, Tan, Log, Pow };
+    
+    // One input domain for the accuracy sweep or the benchmark
+    struct Domain {
+        Function function;
+        const char* label;
+        double lo, hi;         // first argument; log-uniform when logScale
+        bool logScale;
+        double exponentLo, exponentHi; // pow only
+        double snapTo;         // > 0: move samples next to a multiple of snapTo
+    };
+    
+    static constexpr Domain DOMAINS[] = {
+        {Function::Sin, "sin   [-2pi, 2pi]", -6.283185307179586, 6.283185307179586, false, 0, 0, 0},
+        {Function::Sin, "sin   |x| <= 1e6", -1e6, 1e6, false, 0, 0, 0},
+        {Function::Sin, "sin   near k*pi", -3e3, 3e3, false, 0, 0, 3.141592653589793},
+        {Function::Cos, "cos   [-2pi, 2pi]", -6.283185307179586, 6.283185307179586, false, 0, 0, 0},
+        {Function::Cos, "cos   |x| <= 1e6", -1e6, 1e6, false, 0, 0, 0},
+        {Function::Cos, "cos   near k*pi/2", -3e3, 3e3, false, 0, 0, 1.5707963267948966},
+        {Function::Tan, "tan   [-pi/2, pi/2]", -1.5707963267948966, 1.5707963267948966, false, 0, 0, 0},
+        {Function::Tan, "tan   |x| <= 1e6", -1e6, 1e6, false, 0, 0, 0},
+        {Function::Tan, "tan   near k*pi/2", -3e3, 3e3, false, 0, 0, 1.5707963267948966},
+        {Function::Log, "log   [1e-300, 1e300]", 1e-300, 1e300, true, 0, 0, 0},
+        {Function::Log, "log   [0.5, 2]", 0.5, 2.0, false, 0, 0, 0},
+        {Function::Pow, "pow   a in [1e-3, 1e3], b in [-50, 50]", 1e-3, 1e3, true, -50, 50, 0},
+        {Function::Pow, "pow   a in [0.5, 2], b in [-1000, 1000]", 0.5, 2.0, false, -1000, 1000, 0},
+    };
+    
+    static std::uint64_t splitMix(std::uint64_t& state) {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    
+    static double uniform(std::uint64_t& state) {
+        return static_cast<double>(splitMix(state) >> 11) * (1.0 / 9007199254740992.0);
+    }
+    
+    static void sample(const Domain& d, std::uint64_t& state, double& a, double& b) {
+        double u = uniform(state);
+        a = d.logScale ? std::exp(std::log(d.lo) + u * (std::log(d.hi) - std::log(d.lo))) : d.lo + u * (d.hi - d.lo);
+        if (d.snapTo > 0) a = std::nearbyint(a / d.snapTo) * d.snapTo + (uniform(state) - 0.5) * 1e-6;
+        b = d.exponentLo + uniform(state) * (d.exponentHi - d.exponentLo);
+    }
+    
+    static double evaluate(Function f, double a, double b, Precision p) {
+        switch (f) {
+            case Function::Sin: return sin(a, p);
+            case Function::Cos: return cos(a, p);
+            case Function::Tan: return tan(a, p);
+            case Function::Log: return log(a, p);
+            default: return pow(a, b, p);
+        }
+    }
+    
+public:
+    // Sweeps every domain in both polynomial modes against libm and prints
+    // the worst relative error next to its bound. True if all are within.
+    static bool checkAccuracy(std::uint64_t samples) {
+        std::cout << "Checking " << samples << " samples per domain against libm\n\n";
+        std::cout << std::left << std::setw(42) << "domain" << std::setw(8) << "mode" << std::right
+                  << std::setw(13) << "max rel err" << std::setw(10) << "bound" << "\n";
+        bool allWithin = true;
+        for (const Domain& d : DOMAINS) {
+            for (Precision p : {Precision::Fast, Precision::Approx}) {
+                std::uint64_t state = 0x5EED;
+                double worst = 0;
+                for (std::uint64_t i = 0; i < samples; ++i) {
+                    double a, b;
+                    sample(d, state, a, b);
+                    double ref = evaluate(d.function, a, b, Precision::Exact);
+                    if (ref == 0 || !std::isfinite(ref)) continue;
+                    double err = std::fabs(evaluate(d.function, a, b, p) - ref) / std::fabs(ref);
+                    if (!(err <= worst)) worst = err; // NaN counts as a failure
+                }
+                bool within = worst <= errorBound(p);
+                allWithin = allWithin && within;
+                std::cout << std::left << std::setw(42) << d.label << std::setw(8) << name(p) << std::right
+                          << std::scientific << std::setprecision(2) << std::setw(13) << worst
+                          << std::setw(10) << errorBound(p) << (within ? "  ok" : "  FAIL") << "\n";
+            }
+        }
+        std::cout << std::defaultfloat << (allWithin ? "\nAll modes within their bounds.\n"
+                                                      : "\nSome results exceed their bound.\n");
+        return allWithin;
+    }
+    
+    // Calls per second for each function in each mode, on the first
+    // domain of each function
+    static void benchmark(std::uint64_t calls) {
+        constexpr size_t BATCH = 4096;
+        std::vector<double> as(BATCH), bs(BATCH);
+        std::cout << "Timing " << calls << " calls per function and mode\n\n";
+        std::cout << std::left << std::setw(8) << "func" << std::right << std::setw(16) << "exact Mcalls/s"
+                  << std::setw(16) << "fast Mcalls/s" << std::setw(17) << "approx Mcalls/s" << "\n";
+        const char* names[] = {"sin", "cos", "tan", "log", "pow"};
+        for (Function f : {Function::Sin, Function::Cos, Function::Tan, Function::Log, Function::Pow}) {
+            const Domain* d = DOMAINS;
+            while (d->function != f) ++d;
+            std::uint64_t state = 0xBE7C4;
+            for (size_t i = 0; i < BATCH; ++i) sample(*d, state, as[i], bs[i]);
+            
+            std::cout << std::left << std::setw(8) << names[static_cast<int>(f)] << std::right;
+            for (Precision p : {Precision::Exact, Precision::Fast, Precision::Approx}) {
+                volatile double sink = 0;
+                double sum = 0;
+                auto start = std::chrono::steady_clock::now();
+                for (std::uint64_t done = 0; done < calls; done += BATCH) {
+                    for (size_t i = 0; i < BATCH; ++i) sum += evaluate(f, as[i], bs[i], p);
+                }
+                double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                sink = sum;
+                (void)sink;
+                std::uint64_t made = (calls + BATCH - 1) / BATCH * BATCH;
+                std::cout << std::fixed << std::setprecision(1) << std::setw(p == Precision::Approx ? 17 : 16)
+                          << made / secs / 1e6;
+            }
+            std::cout << "\n";
+        }
+        std::cout << std::defaultfloat;
+    }
+};
 
 class Calculator {
 private:
     std::vector<std::string> history;
+    FastMath::Precision precision = FastMath::Precision::Exact; // for the whole session
     
     void addToHistory(const std::string& operation, double result) {
         history.push_back(operation + " = " + std::to_string(result));
@@ -21,24 +391,28 @@ private:
     
 public:
     void displayMenu() {
-        std::cout << "\n╔════════════════════════════════════╗\n";
-        std::cout << "║         ADVANCED CALCULATOR        ║\n";
-        std::cout << "╠════════════════════════════════════╣\n";
-        std::cout << "║  1. Addition (+)                   ║\n";
-        std::cout << "║  2. Subtraction (-)                ║\n";
-        std::cout << "║  3. Multiplication (*)             ║\n";
-        std::cout << "║  4. Division (/)                   ║\n";
-        std::cout << "║  5. Power (x^y)                    ║\n";
-        std::cout << "║  6. Square Root (√x)               ║\n";
-        std::cout << "║  7. Logarithm (ln x)               ║\n";
-        std::cout << "║  8. Sine (sin x)                   ║\n";
-        std::cout << "║  9. Cosine (cos x)                 ║\n";
-        std::cout << "║ 10. Tangent (tan x)                ║\n";
-        std::cout << "║ 11. Factorial (x!)                 ║\n";
-        std::cout << "║ 12. View History                   ║\n";
-        std::cout << "║  0. Exit                           ║\n";
-        std::cout << "╚════════════════════════════════════╝\n";
-        std::cout << "Choice: ";
+        static constexpr std::string_view MENU =
+            "\n╔════════════════════════════════════╗\n"
+            "║         ADVANCED CALCULATOR        ║\n"
+            "╠════════════════════════════════════╣\n"
+            "║  1. Addition (+)                   ║\n"
+            "║  2. Subtraction (-)                ║\n"
+            "║  3. Multiplication (*)             ║\n"
+            "║  4. Division (/)                   ║\n"
+            "║  5. Power (x^y)                    ║\n"
+            "║  6. Square Root (√x)               ║\n"
+            "║  7. Logarithm (ln x)               ║\n"
+            "║  8. Sine (sin x)                   ║\n"
+            "║  9. Cosine (cos x)                 ║\n"
+            "║ 10. Tangent (tan x)                ║\n"
+            "║ 11. Factorial (x!)                 ║\n"
+            "║ 12. View History                   ║\n"
+            "║ 13. Precision Mode                 ║\n"
+            "║  0. Exit                           ║\n"
+            "╚════════════════════════════════════╝\n"
+            "Choice: ";
+        screen() << MENU;
+        screen().flush();
     }
     
     double getNumber(const std::string& prompt) {
@@ -53,6 +427,27 @@ public:
         return num;
     }
     
+    void choosePrecision() {
+        std::cout << "\nCurrent mode: " << FastMath::name(precision) << "\n";
+        std::cout << "1. Exact  (libm)\n";
+        std::cout << "2. Fast   (relative error <= 1e-9)\n";
+        std::cout << "3. Approx (relative error <= 1e-5)\n";
+        int mode = static_cast<int>(getNumber("Mode: "));
+        switch (mode) {
+            case 1: precision = FastMath::Precision::Exact; break;
+            case 2: precision = FastMath::Precision::Fast; break;
+            case 3: precision = FastMath::Precision::Approx; break;
+            default: std::cout << "Invalid choice!\n"; return;
+        }
+        std::cout << "Precision set to " << FastMath::name(precision) << ".\n";
+    }
+    
+    // Marks history entries computed below full precision
+    std::string precisionTag() const {
+        if (precision == FastMath::Precision::Exact) return "";
+        return std::string(" [") + FastMath::name(precision) + "]";
+    }
+    
     long long factorial(int n) {
         if (n < 0) return -1;
         if (n == 0 || n == 1) return 1;
@@ -82,7 +477,7 @@ public:
                         result = a / b; 
                         op = std::to_string(a) + " / " + std::to_string(b); 
                         break;
-                    case 5: result = pow(a, b); op = std::to_string(a) + " ^ " + std::to_string(b); break;
+                    case 5: result = FastMath::pow(a, b, precision); op = std::to_string(a) + " ^ " + std::to_string(b) + precisionTag(); break;
                 }
                 std::cout << "Result: " << std::fixed << std::setprecision(6) << result << "\n";
                 addToHistory(op, result);
@@ -95,15 +490,15 @@ public:
                 switch(choice) {
                     case 6: 
                         if (a < 0) { std::cout << "Error: Negative input!\n"; continue; }
-                        result = sqrt(a); op = "√" + std::to_string(a); 
+                        result = FastMath::sqrt(a, precision); op = "√" + std::to_string(a); 
                         break;
                     case 7: 
                         if (a <= 0) { std::cout << "Error: Invalid input for log!\n"; continue; }
-                        result = log(a); op = "ln(" + std::to_string(a) + ")"; 
+                        result = FastMath::log(a, precision); op = "ln(" + std::to_string(a) + ")" + precisionTag(); 
                         break;
-                    case 8: result = sin(a); op = "sin(" + std::to_string(a) + ")"; break;
-                    case 9: result = cos(a); op = "cos(" + std::to_string(a) + ")"; break;
-                    case 10: result = tan(a); op = "tan(" + std::to_string(a) + ")"; break;
+                    case 8: result = FastMath::sin(a, precision); op = "sin(" + std::to_string(a) + ")" + precisionTag(); break;
+                    case 9: result = FastMath::cos(a, precision); op = "cos(" + std::to_string(a) + ")" + precisionTag(); break;
+                    case 10: result = FastMath::tan(a, precision); op = "tan(" + std::to_string(a) + ")" + precisionTag(); break;
                     case 11: 
                         if (a < 0 || a > 20) { std::cout << "Error: Input too large or negative!\n"; continue; }
                         result = factorial(static_cast<int>(a)); 
@@ -117,6 +512,9 @@ public:
                 std::cout << "\n--- Calculation History ---\n";
                 for (const auto& h : history) std::cout << h << "\n";
             }
+            else if (choice == 13) {
+                choosePrecision();
+            }
             else if (choice != 0) {
                 std::cout << "Invalid choice!\n";
             }